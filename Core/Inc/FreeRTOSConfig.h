@@ -134,6 +134,8 @@ standard names. */
 
 /* USER CODE BEGIN Defines */
 /* Section where parameter definitions can be added (for instance, to override default ones in FreeRTOS.h) */
+/* No DMA heap: every DMA buffer is static in .dma_buffer (RAM_D2) */
+#define configTOTAL_DMA_HEAP_SIZE                ((size_t)0)
 /* USER CODE END Defines */
 
 #endif /* FREERTOS_CONFIG_H */
@@ -26,6 +26,8 @@
 
 /* Private includes ----------------------------------------------------------*/
 /* USER CODE BEGIN Includes */
+#include "pyro_core_dma_heap.h"
+#include "pyro_core_time.h"
 
 /* USER CODE END Includes */
 
@@ -70,6 +72,7 @@ int main(void)
 {
 
   /* USER CODE BEGIN 1 */
+  vPortDmaCacheInit();
 
   /* USER CODE END 1 */
 
@@ -98,6 +101,7 @@ int main(void)
   MX_FDCAN2_Init();
   MX_FDCAN3_Init();
   /* USER CODE BEGIN 2 */
+  pyro_time_init();
 
   /* USER CODE END 2 */
 
@@ -4,6 +4,8 @@
 #include "cmsis_os.h"
 #include "fdcan.h"
 #include "pyro_can_drv.h"
+#include "pyro_can_planner.h"
+#include "pyro_can_scheduler.h"
 
 #include "pyro_position_controller.h"
 #include "pyro_dm_motor_drv.h"
@@ -19,6 +21,7 @@ extern "C"
     pyro::can_drv_t *can1_drv;
     pyro::can_drv_t *can2_drv;
     pyro::can_drv_t *can3_drv;
+    pyro::status_t can_plan_status;
 
     pyro::position_controller_t *ctrl;
     pyro::dm_motor_drv_t *motor;
@@ -30,28 +33,30 @@ extern "C"
     pyro::dr16_drv_t *dr16_drv;
     void pyro_controller_demo(void *arg)
     {
-        pyro::get_uart5().enable_rx_dma();
-        dr16_drv = new pyro::dr16_drv_t(&pyro::get_uart5());
+        pyro::uart_drv_t::get_instance(pyro::uart5)->enable_rx_dma();
+        dr16_drv = new pyro::dr16_drv_t(pyro::uart_drv_t::get_instance(pyro::uart5));
         dr16_drv->init();
         dr16_drv->enable();
 
 
-        pyro::can_hub_t::get_instance();
-        can1_drv = new pyro::can_drv_t(&hfdcan1);
-        can2_drv = new pyro::can_drv_t(&hfdcan2);
-        can3_drv = new pyro::can_drv_t(&hfdcan3);
-
-        can1_drv->init();
-        can2_drv->init();
-        can3_drv->init();
-        can1_drv->start();
-        can2_drv->start();  
-        can3_drv->start();
+        pyro::can_hub_t *hub = pyro::can_hub_t::get_instance();
+        hub->hub_start_all();
+        can1_drv = hub->hub_get_can_obj(pyro::can_hub_t::can1);
+        can2_drv = hub->hub_get_can_obj(pyro::can_hub_t::can2);
+        can3_drv = hub->hub_get_can_obj(pyro::can_hub_t::can3);
+#if CAN_SCHED_EN
+        pyro::can_scheduler_t::get_instance()->start();
+#endif
 
         motor = new pyro::dm_motor_drv_t(0x5, 0x4, pyro::can_hub_t::can1);
         motor->set_position_range(-pyro::PI, pyro::PI);
         motor->set_rotate_range(-20, 20);
         motor->set_torque_range(-10, 10);
+#if CAN_PLAN_EN
+        // PYRO_WARNING if a bus is overloaded, the demo still runs; watch
+        // can_plan_status and see get_plan() per bus
+        can_plan_status = pyro::can_planner_t::get_instance()->analyse();
+#endif
         
         spd_pid   = new pyro::pid_ctrl_t(1.0f, 0.1f, 0.0f);
         spd_pid->set_output_limits(10.0f);
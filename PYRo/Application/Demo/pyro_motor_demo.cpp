@@ -3,6 +3,8 @@
 #include "cmsis_os.h"
 #include "fdcan.h"
 #include "pyro_can_drv.h"
+#include "pyro_can_planner.h"
+#include "pyro_can_scheduler.h"
 #include "pyro_dji_motor_drv.h"
 #include "pyro_dm_motor_drv.h"
 
@@ -13,6 +15,7 @@ extern "C"
     pyro::can_drv_t *can1_drv;
     pyro::can_drv_t *can2_drv;
     pyro::can_drv_t *can3_drv;
+    pyro::status_t can_plan_status;
 
     std::array<uint8_t, 8> can1_data;
     std::array<uint8_t, 8> can2_data;
@@ -30,18 +33,14 @@ extern "C"
 
     void pyro_motor_demo(void *arg)
     {
-        pyro::can_hub_t::get_instance();
-        can1_drv = new pyro::can_drv_t(&hfdcan1);
-        can2_drv = new pyro::can_drv_t(&hfdcan2);
-        can3_drv = new pyro::can_drv_t(&hfdcan3);
-
-        can1_drv->init();
-        can2_drv->init();
-        can3_drv->init();
-
-        can1_drv->start();
-        can2_drv->start();
-        can3_drv->start();
+        pyro::can_hub_t *hub = pyro::can_hub_t::get_instance();
+        hub->hub_start_all();
+        can1_drv = hub->hub_get_can_obj(pyro::can_hub_t::can1);
+        can2_drv = hub->hub_get_can_obj(pyro::can_hub_t::can2);
+        can3_drv = hub->hub_get_can_obj(pyro::can_hub_t::can3);
+#if CAN_SCHED_EN
+        pyro::can_scheduler_t::get_instance()->start();
+#endif
 
         m3508_drv_1 = new pyro::dji_m3508_motor_drv_t(
             pyro::dji_motor_tx_frame_t::id_1, pyro::can_hub_t::can2);
@@ -57,6 +56,11 @@ extern "C"
         dm_drv->set_position_range(-pyro::PI, pyro::PI);
         dm_drv->set_rotate_range(-20, 20);
         dm_drv->set_torque_range(-10, 10);
+#if CAN_PLAN_EN
+        // PYRO_WARNING if a bus is overloaded, the demo still runs; watch
+        // can_plan_status and see get_plan() per bus
+        can_plan_status = pyro::can_planner_t::get_instance()->analyse();
+#endif
 
         HAL_Delay(1000);
         dm_drv->enable();
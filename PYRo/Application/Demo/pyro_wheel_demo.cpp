@@ -3,6 +3,8 @@
 #include "cmsis_os.h"
 #include "fdcan.h"
 #include "pyro_can_drv.h"
+#include "pyro_can_planner.h"
+#include "pyro_can_scheduler.h"
 #include "pyro_wheel_drv.h"
 #include "pyro_dr16_rc_drv.h"
 
@@ -15,6 +17,7 @@ extern "C"
     pyro::can_drv_t *can1_drv;
     pyro::can_drv_t *can2_drv;
     pyro::can_drv_t *can3_drv;
+    pyro::status_t can_plan_status;
 
     std::array<uint8_t, 8> can1_data;
     std::array<uint8_t, 8> can2_data;
@@ -44,18 +47,14 @@ extern "C"
         dr16_drv->init();
         dr16_drv->enable();
 
-        pyro::can_hub_t::get_instance();
-        can1_drv = new pyro::can_drv_t(&hfdcan1);
-        can2_drv = new pyro::can_drv_t(&hfdcan2);
-        can3_drv = new pyro::can_drv_t(&hfdcan3);
-
-        can1_drv->init();
-        can2_drv->init();
-        can3_drv->init();
-
-        can1_drv->start();
-        can2_drv->start();
-        can3_drv->start();
+        pyro::can_hub_t *hub = pyro::can_hub_t::get_instance();
+        hub->hub_start_all();
+        can1_drv = hub->hub_get_can_obj(pyro::can_hub_t::can1);
+        can2_drv = hub->hub_get_can_obj(pyro::can_hub_t::can2);
+        can3_drv = hub->hub_get_can_obj(pyro::can_hub_t::can3);
+#if CAN_SCHED_EN
+        pyro::can_scheduler_t::get_instance()->start();
+#endif
 
         speed_pid_1 = new pyro::pid_ctrl_t(0.1f, 0.0f, 0.00f);
         speed_pid_2 = new pyro::pid_ctrl_t(0.1f, 0.0f, 0.00f);
@@ -104,6 +103,11 @@ extern "C"
         wheel_drv_2->set_gear_ratio(19.0f);
         wheel_drv_3->set_gear_ratio(19.0f);
         wheel_drv_4->set_gear_ratio(19.0f);
+#if CAN_PLAN_EN
+        // PYRO_WARNING if a bus is overloaded, the demo still runs; watch
+        // can_plan_status and see get_plan() per bus
+        can_plan_status = pyro::can_planner_t::get_instance()->analyse();
+#endif
 
         while (true)
         {
@@ -1,4 +1,5 @@
 #include "pyro_dji_motor_drv.h"
+#include "pyro_can_scheduler.h"
 
 #include <cmath>
 #include <cstring>
@@ -10,6 +11,9 @@ dji_motor_tx_frame_t::dji_motor_tx_frame_t(can_hub_t::which_can which,
     : _key(id, which)
 {
     _can = can_hub_t::get_instance()->hub_get_can_obj(_key.second);
+    // Idle motors keep getting the same currents, only refresh those
+    if (_can)
+        _can->set_tx_policy(id, CAN_TX_KEEPALIVE_MS, CAN_TX_MIN_INTERVAL_US);
     _register_list.fill(0);
     _update_list.fill(0);
     _value_list.fill(0);
@@ -39,6 +43,7 @@ status_t dji_motor_tx_frame_t::update_value(uint8_t id,int16_t value)
         return PYRO_ERROR;
     _value_list[id % 4]  = value;
     _update_list[id % 4] = 1;
+#if !CAN_SCHED_EN
     for (uint8_t i = 0; i < 4; i++)
     {
         if (_register_list[i])
@@ -47,6 +52,7 @@ status_t dji_motor_tx_frame_t::update_value(uint8_t id,int16_t value)
                 return PYRO_ERROR;
         }
     }
+#endif
     std::array<uint8_t, 8> data;
     data.fill(0);
     for (uint8_t i = 0; i < 4; i++)
@@ -54,8 +60,15 @@ status_t dji_motor_tx_frame_t::update_value(uint8_t id,int16_t value)
         data[i * 2]     = (_value_list[i] & 0xff00) >> 8;
         data[i * 2 + 1] = _value_list[i] & 0xff;
     }
+#if CAN_SCHED_EN
+    // Restaged on every update, the scheduler sends the latest values of
+    // all four motors once per tick
+    return can_scheduler_t::get_instance()->stage(_key.second, _key.first,
+                                                  data.data());
+#else
     _can->send_msg(_key.first, data.data());
     return PYRO_OK;
+#endif
 }
 
 dji_motor_tx_frame_pool_t::dji_motor_tx_frame_pool_t(void)
@@ -117,16 +130,26 @@ status_t dji_motor_drv_t::disable()
 
 status_t dji_motor_drv_t::update_feedback()
 {
-    static std::array<uint8_t, 8> data;
-    _feedback_msg->get_data(data);
+    uint16_t position;
+    int16_t rotate, torque;
+    int8_t temperature;
+
+    // Decoded straight from the latched frame, may run again on a race
+    if (!_feedback_msg->view(
+            [&](const can_msg_buffer_t::frame_t &frame)
+            {
+                const uint8_t *data = frame.data.data();
+                position            = (uint16_t)((data[0] << 8) | data[1]);
+                rotate              = (int16_t)((data[2] << 8) | data[3]);
+                torque              = (int16_t)((data[4] << 8) | data[5]);
+                temperature         = (int8_t)data[6];
+            }))
+        return PYRO_BUSY;
 
-    _current_position = ((float)((uint16_t)((data[0] << 8) | (data[1])))) /
-                        8192.0f * 2 * PI;
-    _current_rotate =
-        ((float)((int16_t)((data[2] << 8) | (data[3])))) * 2 * pyro::PI / 60;
-    _current_torque = ((float)((int16_t)((data[4] << 8) | (data[5])))) /
-                      _max_torque_i * _max_torque_f;
-    _temperature = (int8_t)(data[6]);
+    _current_position = ((float)position) / 8192.0f * 2 * PI;
+    _current_rotate   = ((float)rotate) * 2 * pyro::PI / 60;
+    _current_torque   = ((float)torque) / _max_torque_i * _max_torque_f;
+    _temperature      = temperature;
 
     return PYRO_OK;
 }
@@ -173,6 +196,7 @@ dji_m3508_motor_drv_t::dji_m3508_motor_drv_t(
     _tx_frame =
         dji_motor_tx_frame_pool_t::get_instance()->get_frame(which, _tx_id);
     _tx_frame->register_id(_register_id);
+    plan_can_flows(_tx_id, CAN_PLAN_CTRL_HZ, _rx_id, FEEDBACK_HZ);
     _max_torque_f = 20.0f;
     _max_torque_i = 16384;
 }
@@ -210,6 +234,7 @@ dji_m2006_motor_drv_t::dji_m2006_motor_drv_t(
     _tx_frame =
         dji_motor_tx_frame_pool_t::get_instance()->get_frame(which, _tx_id);
     _tx_frame->register_id(_register_id);
+    plan_can_flows(_tx_id, CAN_PLAN_CTRL_HZ, _rx_id, FEEDBACK_HZ);
     _max_torque_f = 10.0f;
     _max_torque_i = 10000;
 }
@@ -248,6 +273,7 @@ dji_gm_6020_motor_drv_t::dji_gm_6020_motor_drv_t(
     _tx_frame =
         dji_motor_tx_frame_pool_t::get_instance()->get_frame(which, _tx_id);
     _tx_frame->register_id(_register_id);
+    plan_can_flows(_tx_id, CAN_PLAN_CTRL_HZ, _rx_id, FEEDBACK_HZ);
     _max_torque_f = 3.0f;
     _max_torque_i = 16384;
 }
@@ -58,6 +58,9 @@ class dji_motor_tx_frame_pool_t
 class dji_motor_drv_t : public motor_base_t
 {
   public:
+    // The motors report on their own, whatever the command rate
+    static constexpr uint16_t FEEDBACK_HZ = 1000;
+
     dji_motor_drv_t(dji_motor_tx_frame_t::register_id_t id,
                     can_hub_t::which_can which);
     // ~dji_m_motor_drv_t();
@@ -1,4 +1,5 @@
 #include "pyro_dm_motor_drv.h"
+#include "pyro_can_scheduler.h"
 
 namespace pyro
 {
@@ -12,32 +13,46 @@ dm_motor_drv_t::dm_motor_drv_t(uint32_t can_id, uint32_t master_id,
     if (_can_drv)
     {
         _can_drv->register_rx_msg(_feedback_msg);
+        // Each command is answered by a feedback frame, so an unchanged
+        // torque still goes out; only the rate limit applies
+        _can_drv->set_tx_policy(_can_id, 0, CAN_TX_MIN_INTERVAL_US);
     }
+    // Replies once per command
+    plan_can_flows(_can_id, CAN_PLAN_CTRL_HZ, _master_id, CAN_PLAN_CTRL_HZ);
 }
 
 dm_motor_drv_t::~dm_motor_drv_t()
 {
 }
 
+// State changes share the id with the torque frames. A repeated call sends
+// nothing; a real change skips the tx policy so a delayed torque frame
+// cannot outlive it, and _enable only follows once the command is queued
 status_t pyro::dm_motor_drv_t::enable()
 {
+    if (_enable)
+        return PYRO_OK;
     std::array<uint8_t, 8> data;
     data.fill(0xFF);
     data[7] = 0xfc;
-    _enable = true;
-    if(PYRO_OK!=_can_drv->send_msg(_can_id, data.data()))
+    if(PYRO_OK!=_can_drv->send_msg(_can_id, data.data(), 8,
+                                   can_drv_t::tx_flag_no_gate))
         return PYRO_ERROR;
+    _enable = true;
     return PYRO_OK;
 }
 
 status_t dm_motor_drv_t::disable()
 {
+    if (!_enable)
+        return PYRO_OK;
     std::array<uint8_t, 8> data;
     data.fill(0xFF);
-    data[7] = 0xfc;
-    _enable = false;
-    if(PYRO_OK!=_can_drv->send_msg(_can_id, data.data()))
+    data[7] = 0xfd;
+    if(PYRO_OK!=_can_drv->send_msg(_can_id, data.data(), 8,
+                                   can_drv_t::tx_flag_no_gate))
         return PYRO_ERROR;
+    _enable = false;
     return PYRO_OK;
 }
 
@@ -57,12 +72,17 @@ static float uint_to_float(int x_int, float x_min, float x_max, int bits)
 
 status_t pyro::dm_motor_drv_t::update_feedback()
 {
-    std::array<uint8_t, 8> data;
-    _feedback_msg->get_data(data);
-    uint16_t position = ((uint16_t)((data[1] << 8) | (data[2])));
-    uint16_t rotate   = ((uint16_t)((data[3] << 4) | ((data[4] >> 4) & 0x0f)));
-    uint16_t torque =
-        ((uint16_t)(((data[4] << 8) & 0x0f00) | (data[5] & 0xff)));
+    uint16_t position, rotate, torque;
+    if (!_feedback_msg->view(
+            [&](const can_msg_buffer_t::frame_t &frame)
+            {
+                const uint8_t *data = frame.data.data();
+                position = ((uint16_t)((data[1] << 8) | (data[2])));
+                rotate = ((uint16_t)((data[3] << 4) | ((data[4] >> 4) & 0x0f)));
+                torque =
+                    ((uint16_t)(((data[4] << 8) & 0x0f00) | (data[5] & 0xff)));
+            }))
+        return PYRO_BUSY;
     _current_position =uint_to_float(position, _min_position, _max_position, 16);
     _current_rotate = uint_to_float(rotate, _min_rotate, _max_rotate, 12);
     _current_torque = uint_to_float(torque, _min_torque, _max_torque, 12);
@@ -90,7 +110,12 @@ status_t pyro::dm_motor_drv_t::send_torque(float torque)
     data[6]      = ((kd_int & 0x0f) << 4) | (torque_int >> 8);
     data[7]      = torque_int;
 
+#if CAN_SCHED_EN
+    if(PYRO_OK!=can_scheduler_t::get_instance()->stage(_which_can, _can_id,
+                                                       data.data()))
+#else
     if(PYRO_OK!=_can_drv->send_msg(_can_id, data.data()))
+#endif
     {
         return PYRO_ERROR;
     }
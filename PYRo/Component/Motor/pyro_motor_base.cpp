@@ -1,4 +1,5 @@
 #include "pyro_motor_base.h"
+#include "pyro_can_planner.h"
 
 namespace pyro
 {
@@ -34,4 +35,19 @@ bool motor_base_t::is_enable(void)
     return _enable;
 }
 
+can_msg_buffer_t *motor_base_t::get_feedback_msg(void)
+{
+    return _feedback_msg;
+}
+
+void motor_base_t::plan_can_flows(uint32_t tx_id, uint16_t tx_hz,
+                                  uint32_t rx_id, uint16_t rx_hz)
+{
+#if CAN_PLAN_EN
+    can_planner_t *planner = can_planner_t::get_instance();
+    planner->add_flow(_which_can, tx_id, 8, tx_hz, can_planner_t::dir_tx);
+    planner->add_flow(_which_can, rx_id, 8, rx_hz, can_planner_t::dir_rx);
+#endif
+}
+
 };
\ No newline at end of file
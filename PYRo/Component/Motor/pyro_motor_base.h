@@ -32,8 +32,14 @@ class motor_base_t
     float get_current_torque(void);
 
     bool is_enable(void);
+    // For can_notify_group_t, to wake a loop when the feedback arrives
+    can_msg_buffer_t *get_feedback_msg(void);
 
   protected:
+    // Tells the bus planner about the motor's command and feedback frames
+    void plan_can_flows(uint32_t tx_id, uint16_t tx_hz, uint32_t rx_id,
+                        uint16_t rx_hz);
+
     can_hub_t::which_can _which_can;
     can_drv_t *_can_drv;
 
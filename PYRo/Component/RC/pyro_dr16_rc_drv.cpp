@@ -78,11 +78,8 @@ void dr16_drv_t::enable()
     // Set the priority bit in the base class static sequence variable
     sequence |= (1 << _priority);
     // Register the local rc_callback method as the UART RX event handler
-    _rc_uart->add_rx_event_callback(
-        [this](uint8_t *buf, uint16_t len,
-               BaseType_t xHigherPriorityTaskWoken) -> bool
-        { return rc_callback(buf, len, xHigherPriorityTaskWoken); },
-        reinterpret_cast<uint32_t>(this));
+    _rc_uart->add_rx_event_callback(rx_event, this,
+                                    reinterpret_cast<uint32_t>(this));
 }
 
 /**
@@ -185,7 +182,7 @@ void dr16_drv_t::unpack(const dr16_buf_t *dr16_buf)
  * @return true if data was buffered and the UART buffer should switch.
  */
 bool dr16_drv_t::rc_callback(uint8_t *buf, uint16_t len,
-                             BaseType_t xHigherPriorityTaskWoken)
+                             BaseType_t *xHigherPriorityTaskWoken)
 {
     if (len == 18)
     {
@@ -194,7 +191,7 @@ bool dr16_drv_t::rc_callback(uint8_t *buf, uint16_t len,
         if (__builtin_ctz(sequence) >= _priority)
         {
             xMessageBufferSendFromISR(_rc_msg_buffer, buf, len,
-                                      &xHigherPriorityTaskWoken);
+                                      xHigherPriorityTaskWoken);
             return true;
         }
     }
@@ -144,7 +144,7 @@ class dr16_drv_t : public rc_drv_t
      * Receives raw UART data and forwards it to the FreeRTOS message buffer.
      */
     bool rc_callback(uint8_t *buf, uint16_t len,
-                     BaseType_t xHigherPriorityTaskWoken) override;
+                     BaseType_t *xHigherPriorityTaskWoken) override;
 
     /* Private Methods - Processing
      * --------------------------------------------*/
@@ -60,4 +60,15 @@ rc_drv_t::~rc_drv_t()
         _rc_task_handle = nullptr;
     }
 }
+
+/* UART Trampoline -----------------------------------------------------------*/
+/**
+ * @brief Forwards a UART RX event to the instance given as ctx (ISR context).
+ */
+bool rc_drv_t::rx_event(void *ctx, uint8_t *buf, uint16_t len,
+                        BaseType_t *xHigherPriorityTaskWoken)
+{
+    return static_cast<rc_drv_t *>(ctx)->rc_callback(buf, len,
+                                                     xHigherPriorityTaskWoken);
+}
 } // namespace pyro
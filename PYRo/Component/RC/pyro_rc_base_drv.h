@@ -22,6 +22,9 @@
 #include "semphr.h"         // FreeRTOS Semaphore definitions
 #include "task.h"           // FreeRTOS Task definitions
 
+#include <functional>
+#include <vector>
+
 namespace pyro
 {
 
@@ -61,15 +64,23 @@ class rc_drv_t
      * classes.
      * @param buf Pointer to the received data buffer.
      * @param len Length of the received data.
-     * @param xHigherPriorityTaskWoken Flag for FreeRTOS context switching.
+     * @param xHigherPriorityTaskWoken Flag for FreeRTOS context switching,
+     * passed on to the FromISR calls.
      * @return true if the buffer was processed and should be switched by the
      * UART driver.
      */
     virtual bool rc_callback(uint8_t *buf, uint16_t len,
-                             BaseType_t xHigherPriorityTaskWoken) = 0;
+                             BaseType_t *xHigherPriorityTaskWoken) = 0;
 
 
   protected:
+    /**
+     * @brief Static trampoline registered with the UART driver; ctx is the
+     * rc_drv_t instance.
+     */
+    static bool rx_event(void *ctx, uint8_t *buf, uint16_t len,
+                         BaseType_t *xHigherPriorityTaskWoken);
+
     /* Protected Members - Resources and State
      * ---------------------------------*/
     /**
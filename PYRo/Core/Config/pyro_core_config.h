@@ -13,5 +13,58 @@
 
 #endif
 
+/* Cortex-M7 cache, see vPortDmaCacheInit */
+#define DCACHE_EN             1  // drivers clean / invalidate their DMA buffers
+#define DMA_HEAP_MPU_EN       0  // RAM_D2 non-cacheable instead of maintenance
 
-#endif //PYRO_PYRO_CORE_CONFIG_H
\ No newline at end of file
+/* UART driver */
+#define UART_RX_CB_NUM        4  // rx event callbacks per uart
+#define UART_TX_DESC_NUM      8  // queued dma transfers per uart
+#define UART_TX_BUF_LEN       256 // copy ring for write(), power of 2
+
+/* CAN driver */
+#define CAN_BUS_NUM           3  // FDCAN1..FDCAN3
+#define CAN_RX_ID_MAX_NUM     32 // standard ids registered per bus, < 255
+#define CAN_RX_EXT_ID_MAX_NUM 8  // extended ids registered per bus
+#define CAN_RX_BATCH_MAX      16 // frames drained per rx interrupt
+#define CAN_RX_BUFFER_MAX_NUM 8  // ids latched in dedicated rx buffers per bus
+#define CAN_RX_DEFERRED_EN    1  // rx ring + dispatcher task, see set_rx_mode
+#define CAN_RX_RING_LEN       32 // deferred frames per bus, power of 2
+#define CAN_RX_TASK_PRIORITY  (configMAX_PRIORITIES - 1)
+#define CAN_RX_TASK_STACK_SIZE 256 // words
+#define CAN_RX_LATENCY_HIST_EN 1 // per id inter-arrival / age histograms
+#define CAN_TX_QUEUE_LEN      32 // software tx frames per priority, power of 2
+#define CAN_TX_EVENT_EN       1  // tx event fifo: queueing / arbitration delay
+#define CAN_TX_GATE_NUM       8  // tx ids with a suppression policy per bus
+#define CAN_TX_KEEPALIVE_MS   50 // DJI motor commands: unchanged frame resend
+#define CAN_TX_MIN_INTERVAL_US 500 // motor commands: at most 2 kHz per id
+#define CAN_FD_EN             1  // FD frames on buses configured as FD in CubeMX
+#if CAN_FD_EN
+#define CAN_MAX_DATA_LEN      64
+#else
+#define CAN_MAX_DATA_LEN      8
+#endif
+#define CAN_HEALTH_POLL_MS    100  // bus health window, polled by the monitor
+#define CAN_RECOVER_MIN_MS    10   // first bus-off restart delay
+#define CAN_RECOVER_MAX_MS    1000 // restart delay doubles up to this
+#define CAN_TIME_SYNC_EN      1    // rx times from the FDCAN timestamp counter
+#define CAN_TIME_SYNC_MS      10   // sync period by the monitor, inside a wrap
+#define CAN_TIME_SYNC_WINDOW_MS 1000 // counter rate measured over this
+#define CAN_MONITOR_PERIOD_MS 1    // monitor task, started by hub_start_all
+#define CAN_MONITOR_PRIORITY  (configMAX_PRIORITIES - 2)
+#define CAN_MONITOR_STACK_SIZE 256 // words
+
+/* CAN tx scheduler, motors stage frames and send once per control tick */
+#define CAN_SCHED_EN          1
+#define CAN_SCHED_SLOT_NUM    8   // tx ids per bus
+#define CAN_SCHED_PERIOD_MS   1   // control tick
+#define CAN_SCHED_PRIORITY    (configMAX_PRIORITIES - 1)
+#define CAN_SCHED_STACK_SIZE  256 // words
+
+#define CAN_PLAN_EN            1
+#define CAN_PLAN_FLOW_MAX      32  // expected rx / tx ids per bus
+#define CAN_PLAN_CTRL_HZ       1000 // command rate assumed for motor tx frames
+#define CAN_PLAN_WARN_PERMILLE 700 // bus load flagged as overload
+
+
+#endif //PYRO_PYRO_CORE_CONFIG_H
@@ -0,0 +1,206 @@
+#ifndef FRAME_PARSER_H
+#define FRAME_PARSER_H
+
+#include "pyro_crc.h"
+#include "spsc_ring.h"
+
+#include <cstring>
+
+namespace pyro
+{
+// Incremental parser for serial frames laid out as
+//   SOF | len (u16 le) | ... | crc8 | extra | payload[len] | crc16 (u16 le)
+// where the header is HEAD_LEN bytes ending in its crc8, and extra bytes
+// (the cmd id of the referee protocol) are not counted by len. crc16 covers
+// everything before it. The defaults are the RoboMaster referee layout.
+//
+// Bytes may arrive in any chunking. Frames are assembled in place in slots
+// of a ring, so the consumer reads them without another copy: feed() from
+// the rx callback, front() / release() from one consumer task. No HAL or
+// RTOS calls, so the same code runs in a host tool.
+template <uint16_t MAX_FRAME, uint32_t POOL_NUM, uint8_t SOF = 0xA5,
+          uint8_t HEAD_LEN = 5, uint8_t EXTRA_LEN = 2>
+class frame_parser_t
+{
+    static_assert(HEAD_LEN >= 4, "header holds SOF, len and crc8");
+    static_assert(MAX_FRAME > HEAD_LEN + EXTRA_LEN + 2, "frame too small");
+
+  public:
+    typedef struct frame_t
+    {
+        uint16_t len; // whole frame
+        uint8_t data[MAX_FRAME];
+    } frame_t;
+
+    typedef struct stats_t
+    {
+        uint32_t byte_num;
+        uint32_t frame_num;
+        uint32_t head_err_num; // header crc8 failed, rescanned
+        uint32_t crc_err_num;  // frame crc16 failed
+        uint32_t oversize_num; // len beyond MAX_FRAME, rescanned
+        uint32_t drop_num;     // good header but no free slot
+    } stats_t;
+
+    static constexpr uint16_t PAYLOAD_OFFSET = HEAD_LEN + EXTRA_LEN;
+
+    frame_parser_t() : _head(), _stats()
+    {
+    }
+    frame_parser_t(const frame_parser_t &)            = delete;
+    frame_parser_t &operator=(const frame_parser_t &) = delete;
+
+    // Producer side
+    void feed(const uint8_t *p, size_t n)
+    {
+        _stats.byte_num += n;
+        parse(p, n);
+    }
+
+    // Any span with data[2] / len[2], e.g. uart_drv_t::rx_span_t
+    template <typename Span> void feed(const Span &span)
+    {
+        feed(span.data[0], span.len[0]);
+        if (span.len[1])
+            feed(span.data[1], span.len[1]);
+    }
+
+    // Drops a partly received frame, e.g. after the stream restarted
+    void reset()
+    {
+        _state = state_hunt;
+    }
+
+    // Consumer side. nullptr if no frame is complete
+    const frame_t *front()
+    {
+        return _pool.front();
+    }
+
+    void release()
+    {
+        _pool.release();
+    }
+
+    const stats_t &get_stats() const
+    {
+        return _stats;
+    }
+
+    static uint16_t payload_len(const frame_t &frame)
+    {
+        return frame.len - PAYLOAD_OFFSET - 2;
+    }
+
+  private:
+    enum state_t
+    {
+        state_hunt,
+        state_head,
+        state_body
+    };
+
+    void parse(const uint8_t *p, size_t n)
+    {
+        while (n)
+        {
+            if (state_hunt == _state)
+            {
+                const uint8_t *sof =
+                    static_cast<const uint8_t *>(memchr(p, SOF, n));
+                if (nullptr == sof)
+                    return;
+                n -= sof - p + 1;
+                p        = sof + 1;
+                _head[0] = SOF;
+                _got     = 1;
+                _state   = state_head;
+            }
+            else if (state_head == _state)
+            {
+                size_t left = static_cast<size_t>(HEAD_LEN - _got);
+                size_t take = left < n ? left : n;
+                memcpy(_head + _got, p, take);
+                _got += take;
+                p += take;
+                n -= take;
+                if (_got == HEAD_LEN)
+                    begin_frame();
+            }
+            else
+            {
+                size_t left = static_cast<size_t>(_need - _got);
+                size_t take = left < n ? left : n;
+                if (_slot)
+                    memcpy(_slot->data + _got, p, take);
+                _got += take;
+                p += take;
+                n -= take;
+                if (_got == _need)
+                    end_frame();
+            }
+        }
+    }
+
+    void begin_frame()
+    {
+        if (crc8(_head, HEAD_LEN - 1) != _head[HEAD_LEN - 1])
+        {
+            _stats.head_err_num++;
+            rescan_head();
+            return;
+        }
+        uint32_t len = _head[1] | _head[2] << 8;
+        if (PAYLOAD_OFFSET + len + 2 > MAX_FRAME)
+        {
+            _stats.oversize_num++;
+            rescan_head();
+            return;
+        }
+        _need  = static_cast<uint16_t>(PAYLOAD_OFFSET + len + 2);
+        _slot  = _pool.claim();
+        _state = state_body;
+        if (_slot)
+            memcpy(_slot->data, _head, HEAD_LEN);
+    }
+
+    // The SOF was a data byte; look for the next one among the header bytes
+    void rescan_head()
+    {
+        uint8_t rest[HEAD_LEN - 1];
+        memcpy(rest, _head + 1, HEAD_LEN - 1);
+        _state = state_hunt;
+        parse(rest, HEAD_LEN - 1);
+    }
+
+    // A crc16 failure had a valid header, so hunting goes on after it
+    void end_frame()
+    {
+        _state = state_hunt;
+        if (nullptr == _slot)
+        {
+            _stats.drop_num++;
+            return;
+        }
+        uint16_t crc = _slot->data[_need - 2] | _slot->data[_need - 1] << 8;
+        if (crc16(_slot->data, _need - 2) != crc)
+        {
+            _stats.crc_err_num++;
+            return;
+        }
+        _slot->len = _need;
+        _pool.commit();
+        _stats.frame_num++;
+    }
+
+    spsc_ring_t<frame_t, POOL_NUM> _pool;
+    state_t _state{state_hunt};
+    uint8_t _head[HEAD_LEN];
+    uint16_t _got{};  // bytes of the current header / frame so far
+    uint16_t _need{}; // frame length once the header is good
+    frame_t *_slot{}; // nullptr while skipping a frame with no free slot
+    stats_t _stats;
+};
+} // namespace pyro
+
+#endif
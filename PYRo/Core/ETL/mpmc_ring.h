@@ -0,0 +1,117 @@
+#ifndef MPMC_RING_H
+#define MPMC_RING_H
+#include <array>
+#include <atomic>
+#include <cstdint>
+namespace pyro
+{
+// Bounded lock free multi producer / multi consumer ring (Vyukov). Every
+// cell carries a sequence number, producers and consumers claim positions
+// with a CAS and publish through the cell sequence. push / pop never block,
+// so both may be called from tasks and interrupts.
+//
+// On a single core a consumer that preempts a producer between claiming and
+// publishing a cell sees the ring as empty at that cell; the producer is
+// expected to kick the consumer side again once push returns.
+template <typename T, uint32_t N> class mpmc_ring_t
+{
+    static_assert(N >= 2 && (N & (N - 1)) == 0, "size must be a power of 2");
+
+  public:
+    mpmc_ring_t() : _enqueue_pos(0), _dequeue_pos(0)
+    {
+        for (uint32_t i = 0; i < N; i++)
+            _cells[i].seq.store(i, std::memory_order_relaxed);
+    }
+    mpmc_ring_t(const mpmc_ring_t &)            = delete;
+    mpmc_ring_t &operator=(const mpmc_ring_t &) = delete;
+
+    bool push(const T &value)
+    {
+        cell_t *cell;
+        uint32_t pos = _enqueue_pos.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            cell         = &_cells[pos & (N - 1)];
+            uint32_t seq = cell->seq.load(std::memory_order_acquire);
+            int32_t dif  = static_cast<int32_t>(seq - pos);
+            if (dif == 0)
+            {
+                if (_enqueue_pos.compare_exchange_weak(
+                        pos, pos + 1, std::memory_order_relaxed))
+                    break;
+            }
+            else if (dif < 0)
+            {
+                return false; // full
+            }
+            else
+            {
+                pos = _enqueue_pos.load(std::memory_order_relaxed);
+            }
+        }
+        cell->value = value;
+        cell->seq.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool pop(T &value)
+    {
+        cell_t *cell;
+        uint32_t pos = _dequeue_pos.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            cell         = &_cells[pos & (N - 1)];
+            uint32_t seq = cell->seq.load(std::memory_order_acquire);
+            int32_t dif  = static_cast<int32_t>(seq - (pos + 1));
+            if (dif == 0)
+            {
+                if (_dequeue_pos.compare_exchange_weak(
+                        pos, pos + 1, std::memory_order_relaxed))
+                    break;
+            }
+            else if (dif < 0)
+            {
+                return false; // empty
+            }
+            else
+            {
+                pos = _dequeue_pos.load(std::memory_order_relaxed);
+            }
+        }
+        value = cell->value;
+        cell->seq.store(pos + N, std::memory_order_release);
+        return true;
+    }
+
+    // Snapshot only, may be stale as soon as it returns
+    uint32_t size() const
+    {
+        uint32_t enq = _enqueue_pos.load(std::memory_order_relaxed);
+        uint32_t deq = _dequeue_pos.load(std::memory_order_relaxed);
+        return enq - deq;
+    }
+
+    bool empty() const
+    {
+        return size() == 0;
+    }
+
+    static constexpr uint32_t capacity()
+    {
+        return N;
+    }
+
+  private:
+    typedef struct cell_t
+    {
+        std::atomic<uint32_t> seq;
+        T value;
+    } cell_t;
+
+    std::array<cell_t, N> _cells;
+    std::atomic<uint32_t> _enqueue_pos;
+    std::atomic<uint32_t> _dequeue_pos;
+};
+} // namespace pyro
+#endif
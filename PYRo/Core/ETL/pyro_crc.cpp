@@ -0,0 +1,48 @@
+#include "pyro_crc.h"
+
+namespace pyro
+{
+namespace
+{
+typedef struct crc_table_t
+{
+    uint8_t crc8[256];
+    uint16_t crc16[256];
+} crc_table_t;
+
+// Built by the compiler, so the tables end up in flash
+constexpr crc_table_t make_crc_table()
+{
+    crc_table_t table{};
+    for (uint32_t i = 0; i < 256; i++)
+    {
+        uint8_t c8   = static_cast<uint8_t>(i);
+        uint16_t c16 = static_cast<uint16_t>(i);
+        for (uint8_t bit = 0; bit < 8; bit++)
+        {
+            c8  = (c8 & 1U) ? (c8 >> 1) ^ 0x8C : c8 >> 1;
+            c16 = (c16 & 1U) ? (c16 >> 1) ^ 0x8408 : c16 >> 1;
+        }
+        table.crc8[i]  = c8;
+        table.crc16[i] = c16;
+    }
+    return table;
+}
+
+constexpr crc_table_t crc_table = make_crc_table();
+} // namespace
+
+uint8_t crc8(const uint8_t *p, size_t n, uint8_t crc)
+{
+    while (n--)
+        crc = crc_table.crc8[crc ^ *p++];
+    return crc;
+}
+
+uint16_t crc16(const uint8_t *p, size_t n, uint16_t crc)
+{
+    while (n--)
+        crc = (crc >> 8) ^ crc_table.crc16[(crc ^ *p++) & 0xFF];
+    return crc;
+}
+} // namespace pyro
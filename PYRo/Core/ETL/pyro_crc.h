@@ -0,0 +1,20 @@
+#ifndef PYRO_CRC_H
+#define PYRO_CRC_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace pyro
+{
+// Table driven CRCs of the DJI / RoboMaster serial links, referee system
+// included: CRC-8/MAXIM (reflected 0x31) and CRC-16/MCRF4XX (reflected
+// 0x1021), both without a final xor. Pass the previous result as crc to
+// continue over split data.
+constexpr uint8_t CRC8_INIT   = 0xFF;
+constexpr uint16_t CRC16_INIT = 0xFFFF;
+
+uint8_t crc8(const uint8_t *p, size_t n, uint8_t crc = CRC8_INIT);
+uint16_t crc16(const uint8_t *p, size_t n, uint16_t crc = CRC16_INIT);
+} // namespace pyro
+
+#endif
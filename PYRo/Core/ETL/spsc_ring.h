@@ -0,0 +1,94 @@
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+#include <array>
+#include <atomic>
+#include <cstdint>
+namespace pyro
+{
+// Bounded lock free single producer / single consumer ring. Besides push /
+// pop, claim + commit and front + release give in place access to the slot
+// so large elements are written and read without an extra copy.
+template <typename T, uint32_t N> class spsc_ring_t
+{
+    static_assert(N >= 2 && (N & (N - 1)) == 0, "size must be a power of 2");
+
+  public:
+    spsc_ring_t() : _head(0), _tail(0)
+    {
+    }
+    spsc_ring_t(const spsc_ring_t &)            = delete;
+    spsc_ring_t &operator=(const spsc_ring_t &) = delete;
+
+    // Producer side. nullptr if full, the slot is published by commit
+    T *claim()
+    {
+        uint32_t head = _head.load(std::memory_order_relaxed);
+        if (head - _tail.load(std::memory_order_acquire) >= N)
+            return nullptr;
+        return &_buf[head & (N - 1)];
+    }
+
+    void commit()
+    {
+        _head.store(_head.load(std::memory_order_relaxed) + 1,
+                    std::memory_order_release);
+    }
+
+    bool push(const T &value)
+    {
+        T *slot = claim();
+        if (nullptr == slot)
+            return false;
+        *slot = value;
+        commit();
+        return true;
+    }
+
+    // Consumer side. nullptr if empty, the slot is handed back by release
+    T *front()
+    {
+        uint32_t tail = _tail.load(std::memory_order_relaxed);
+        if (tail == _head.load(std::memory_order_acquire))
+            return nullptr;
+        return &_buf[tail & (N - 1)];
+    }
+
+    void release()
+    {
+        _tail.store(_tail.load(std::memory_order_relaxed) + 1,
+                    std::memory_order_release);
+    }
+
+    bool pop(T &value)
+    {
+        T *slot = front();
+        if (nullptr == slot)
+            return false;
+        value = *slot;
+        release();
+        return true;
+    }
+
+    uint32_t size() const
+    {
+        return _head.load(std::memory_order_acquire) -
+               _tail.load(std::memory_order_acquire);
+    }
+
+    bool empty() const
+    {
+        return size() == 0;
+    }
+
+    static constexpr uint32_t capacity()
+    {
+        return N;
+    }
+
+  private:
+    std::array<T, N> _buf;
+    std::atomic<uint32_t> _head;
+    std::atomic<uint32_t> _tail;
+};
+} // namespace pyro
+#endif
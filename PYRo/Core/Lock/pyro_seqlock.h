@@ -0,0 +1,110 @@
+#ifndef __PYRO_SEQLOCK_H__
+#define __PYRO_SEQLOCK_H__
+
+#include <atomic>
+#include <cstdint>
+
+namespace pyro
+{
+
+/**
+ * @brief 单写者顺序锁（seqlock）
+ *
+ * 写者（通常是中断）在写入前后各递增一次序号，读者拷贝数据后检查序号
+ * 是否变化，变化则重试。读写双方都不关中断、不使用信号量。
+ * - 只允许一个写者。
+ * - 读者优先级高于写者时可能一直读到写入中的状态，因此重试次数有限，
+ *   失败时返回 false。
+ */
+template <typename T> class seqlock_t
+{
+  public:
+    static constexpr uint8_t READ_RETRY = 4;
+
+    seqlock_t() : _seq(0), _value()
+    {
+    }
+
+    seqlock_t(const seqlock_t &)            = delete;
+    seqlock_t &operator=(const seqlock_t &) = delete;
+
+    /**
+     * @brief 开始原地写入，返回内部数据的引用，必须与 write_end 成对调用
+     */
+    T &write_begin()
+    {
+        _seq.store(_seq.load(std::memory_order_relaxed) + 1,
+                   std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        return _value;
+    }
+
+    void write_end()
+    {
+        std::atomic_thread_fence(std::memory_order_release);
+        _seq.store(_seq.load(std::memory_order_relaxed) + 1,
+                   std::memory_order_relaxed);
+    }
+
+    void write(const T &value)
+    {
+        write_begin() = value;
+        write_end();
+    }
+
+    /**
+     * @brief 读取一份一致的快照
+     * @return true 如果读到完整数据, false 如果重试次数用尽
+     */
+    bool read(T &out) const
+    {
+        for (uint8_t i = 0; i < READ_RETRY; i++)
+        {
+            uint32_t seq = _seq.load(std::memory_order_acquire);
+            if (seq & 1U)
+                continue;
+            out = _value;
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (seq == _seq.load(std::memory_order_relaxed))
+                return true;
+        }
+        return false;
+    }
+
+    /**
+     * @brief 不拷贝数据，直接在内部数据上调用 fn(const T &)
+     *
+     * 与写者冲突时 fn 会被再次调用，因此 fn 只应把结果写入局部变量，
+     * 返回 true 后再提交。
+     * @return true 如果 fn 最后一次看到的是完整数据
+     */
+    template <typename F> bool read_with(F &&fn) const
+    {
+        for (uint8_t i = 0; i < READ_RETRY; i++)
+        {
+            uint32_t seq = _seq.load(std::memory_order_acquire);
+            if (seq & 1U)
+                continue;
+            fn(static_cast<const T &>(_value));
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (seq == _seq.load(std::memory_order_relaxed))
+                return true;
+        }
+        return false;
+    }
+
+    /**
+     * @brief 当前序号，每完成一次写入加 2
+     */
+    uint32_t sequence() const
+    {
+        return _seq.load(std::memory_order_acquire);
+    }
+
+  private:
+    std::atomic<uint32_t> _seq;
+    T _value;
+};
+
+} // namespace pyro
+#endif
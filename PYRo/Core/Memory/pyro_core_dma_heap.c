@@ -2,6 +2,12 @@
 #include "FreeRTOS.h"
 #include "task.h"
 #include "pyro_core_dma_heap.h"
+#include "pyro_core_config.h"
+#include "stm32h7xx_hal.h"
+
+/* DMA 块按 D-cache 行对齐，大小也取整到整行，缓存维护不会波及相邻数据 */
+#define dmaBYTE_ALIGNMENT			DMA_CACHE_LINE_SIZE
+#define dmaBYTE_ALIGNMENT_MASK		( dmaBYTE_ALIGNMENT - 1 )
 
 #define heapMINIMUM_BLOCK_SIZE	( ( size_t ) ( xHeapStructSize << 1 ) )
 
@@ -13,7 +19,7 @@ typedef struct A_BLOCK_LINK
     size_t xBlockSize;						/*<< The size of the free block. */
 } BlockLink_t;
 
-static const size_t xHeapStructSize	= ( sizeof( BlockLink_t ) + ( ( size_t ) ( portBYTE_ALIGNMENT - 1 ) ) ) & ~( ( size_t ) portBYTE_ALIGNMENT_MASK );
+static const size_t xHeapStructSize	= ( sizeof( BlockLink_t ) + ( ( size_t ) ( dmaBYTE_ALIGNMENT - 1 ) ) ) & ~( ( size_t ) dmaBYTE_ALIGNMENT_MASK );
 
 /* Gets set to the top bit of an size_t type.  When this bit in the xBlockSize
 member of an BlockLink_t structure is set then the block belongs to the
@@ -27,19 +33,26 @@ static size_t xBlockAllocatedBit = 0;
  * 新增一个独立的 DMA 堆。它与主堆完全独立，使用相同的分配策略（合并空闲块）。
  *
  * 配置选项（可在 FreeRTOSConfig.h 中定义）:
- *  - configTOTAL_DMA_HEAP_SIZE           : DMA 堆大小（字节）。若未定义或为 0，则 DMA 堆不可用，相关函数返回 NULL / 0。
+ *  - configTOTAL_DMA_HEAP_SIZE           : DMA 堆大小（字节），未定义时为 1024。为 0 时 DMA 堆不可用，
+ *                                          pvPortDmaMalloc 触发 configASSERT 并返回 NULL，统计全为 0。
+ *
+ * 本工程在 FreeRTOSConfig.h 中把它定义为 0：DMA 内存只来自 .dma_buffer 段里的静态缓冲区
+ * （见 pyro_uart_drv.cpp），新的 DMA 缓冲区也应放进该段，而不是运行时申请。
  *  - configAPPLICATION_ALLOCATED_DMA_HEAP: 若为 1，应用需提供 ucDmaHeap[] 缓冲区（同主堆的配置方式）。
  *
  * 提供函数:
  *  - void *pvPortDmaMalloc( size_t xWantedSize );
  *  - void  vPortDmaFree( void *pv );
+ *  - void  vPortDmaCacheClean( const void *pv, size_t xSize );
+ *  - void  vPortDmaCacheInvalidate( void *pv, size_t xSize );
+ *  - void  vPortDmaCacheInit( void );
  *  - void  vPortGetDmaHeapStats( HeapStats_t *pxHeapStats );
  *
  * 注意：该实现尽量与主堆行为一致（对齐、trace、assert），但不会改变原有主堆逻辑。
  */
 
 #ifndef configTOTAL_DMA_HEAP_SIZE
-	/* 默认 DMA 堆大小为 0（不可用），如果需要使用请在 FreeRTOSConfig.h 中定义一个合理值 */
+	/* 未定义时给 1KB；不需要 DMA 堆请在 FreeRTOSConfig.h 中定义为 0 */
 	#define configTOTAL_DMA_HEAP_SIZE 1024
 #endif
 
@@ -48,7 +61,7 @@ static size_t xBlockAllocatedBit = 0;
 	#if( configAPPLICATION_ALLOCATED_DMA_HEAP == 1 )
 		extern uint8_t ucDmaHeap[ configTOTAL_DMA_HEAP_SIZE ];
 	#else
-		__attribute__((section(".dma_heap"))) static uint8_t ucDmaHeap[ configTOTAL_DMA_HEAP_SIZE ];
+		__attribute__((section(".dma_heap"), aligned(DMA_CACHE_LINE_SIZE))) static uint8_t ucDmaHeap[ configTOTAL_DMA_HEAP_SIZE ];
 	#endif /* configAPPLICATION_ALLOCATED_DMA_HEAP */
 
 	/* DMA 堆的起始/结束标记和统计变量（与主堆分离） */
@@ -96,10 +109,10 @@ static size_t xBlockAllocatedBit = 0;
 				{
 					xWantedSize += xHeapStructSize;
 
-					if( ( xWantedSize & portBYTE_ALIGNMENT_MASK ) != 0x00 )
+					if( ( xWantedSize & dmaBYTE_ALIGNMENT_MASK ) != 0x00 )
 					{
-						xWantedSize += ( portBYTE_ALIGNMENT - ( xWantedSize & portBYTE_ALIGNMENT_MASK ) );
-						configASSERT( ( xWantedSize & portBYTE_ALIGNMENT_MASK ) == 0 );
+						xWantedSize += ( dmaBYTE_ALIGNMENT - ( xWantedSize & dmaBYTE_ALIGNMENT_MASK ) );
+						configASSERT( ( xWantedSize & dmaBYTE_ALIGNMENT_MASK ) == 0 );
 					}
 					else
 					{
@@ -133,7 +146,7 @@ static size_t xBlockAllocatedBit = 0;
 						if( ( pxBlock->xBlockSize - xWantedSize ) > heapMINIMUM_BLOCK_SIZE )
 						{
 							pxNewBlockLink = ( void * ) ( ( ( uint8_t * ) pxBlock ) + xWantedSize );
-							configASSERT( ( ( ( size_t ) pxNewBlockLink ) & portBYTE_ALIGNMENT_MASK ) == 0 );
+							configASSERT( ( ( ( size_t ) pxNewBlockLink ) & dmaBYTE_ALIGNMENT_MASK ) == 0 );
 
 							pxNewBlockLink->xBlockSize = pxBlock->xBlockSize - xWantedSize;
 							pxBlock->xBlockSize = xWantedSize;
@@ -193,7 +206,7 @@ static size_t xBlockAllocatedBit = 0;
 		}
 		#endif
 
-		configASSERT( ( ( ( size_t ) pvReturn ) & ( size_t ) portBYTE_ALIGNMENT_MASK ) == 0 );
+		configASSERT( ( ( ( size_t ) pvReturn ) & ( size_t ) dmaBYTE_ALIGNMENT_MASK ) == 0 );
 		return pvReturn;
 	}
 
@@ -261,10 +274,10 @@ static size_t xBlockAllocatedBit = 0;
 		/* Ensure the heap starts on a correctly aligned boundary. */
 		uxAddress = ( size_t ) ucDmaHeap;
 
-		if( ( uxAddress & portBYTE_ALIGNMENT_MASK ) != 0 )
+		if( ( uxAddress & dmaBYTE_ALIGNMENT_MASK ) != 0 )
 		{
-			uxAddress += ( portBYTE_ALIGNMENT - 1 );
-			uxAddress &= ~( ( size_t ) portBYTE_ALIGNMENT_MASK );
+			uxAddress += ( dmaBYTE_ALIGNMENT - 1 );
+			uxAddress &= ~( ( size_t ) dmaBYTE_ALIGNMENT_MASK );
 			xTotalHeapSize -= uxAddress - ( size_t ) ucDmaHeap;
 		}
 
@@ -277,7 +290,7 @@ static size_t xBlockAllocatedBit = 0;
 		/* pxDmaEnd marks the end of the DMA heap */
 		uxAddress = ( ( size_t ) pucAlignedHeap ) + xTotalHeapSize;
 		uxAddress -= xHeapStructSize;
-		uxAddress &= ~( ( size_t ) portBYTE_ALIGNMENT_MASK );
+		uxAddress &= ~( ( size_t ) dmaBYTE_ALIGNMENT_MASK );
 		pxDmaEnd = ( void * ) uxAddress;
 		pxDmaEnd->xBlockSize = 0;
 		pxDmaEnd->pxNextFreeBlock = NULL;
@@ -408,15 +421,19 @@ static void prvInsertDmaBlockIntoFreeList( BlockLink_t *pxBlockToInsert )
 
 #else /* configTOTAL_DMA_HEAP_SIZE == 0 */
 
-/* 如果未启用 DMA 堆，则提供弱的替代实现，方便上层调用不必 #ifdef */
+/* 如果未启用 DMA 堆，则提供空实现，方便上层调用不必 #ifdef。
+ * 不退回 malloc：主堆在 DTCM，DMA1/DMA2 访问不到。
+ * 申请必然失败，所以 assert：缓冲区应改为 .dma_buffer 中的静态数组。 */
 void *pvPortDmaMalloc( size_t xWantedSize )
 {
-	return malloc(xWantedSize);
+	( void ) xWantedSize;
+	configASSERT( pdFALSE );
+	return NULL;
 }
 
 void vPortDmaFree( void *pv )
 {
-        free(pv);
+	( void ) pv;
 }
 
 void vPortGetDmaHeapStats( HeapStats_t *pxHeapStats )
@@ -435,3 +452,65 @@ void vPortGetDmaHeapStats( HeapStats_t *pxHeapStats )
 
 #endif /* configTOTAL_DMA_HEAP_SIZE */
 
+/* ========== D-cache 维护 ========== */
+/*
+ * DMA 发送前 clean（把 CPU 写入的数据写回内存），DMA 接收前后 invalidate
+ * （丢弃旧的缓存行）。范围按整行扩展，所以只对 DMA 堆中的缓冲区做 invalidate；
+ * clean 对任意地址都是安全的。D-cache 未开启时直接返回。
+ */
+void vPortDmaCacheClean( const void *pv, size_t xSize )
+{
+#if( __DCACHE_PRESENT == 1U )
+	if( ( pv != NULL ) && ( xSize > 0U ) && ( ( SCB->CCR & SCB_CCR_DC_Msk ) != 0U ) )
+	{
+		uint32_t ulStart = ( uint32_t ) pv & ~( DMA_CACHE_LINE_SIZE - 1U );
+		uint32_t ulEnd = ( ( uint32_t ) pv + xSize + DMA_CACHE_LINE_SIZE - 1U ) & ~( DMA_CACHE_LINE_SIZE - 1U );
+		SCB_CleanDCache_by_Addr( ( uint32_t * ) ulStart, ( int32_t ) ( ulEnd - ulStart ) );
+	}
+#endif
+}
+
+void vPortDmaCacheInvalidate( void *pv, size_t xSize )
+{
+#if( __DCACHE_PRESENT == 1U )
+	if( ( pv != NULL ) && ( xSize > 0U ) && ( ( SCB->CCR & SCB_CCR_DC_Msk ) != 0U ) )
+	{
+		uint32_t ulStart = ( uint32_t ) pv & ~( DMA_CACHE_LINE_SIZE - 1U );
+		uint32_t ulEnd = ( ( uint32_t ) pv + xSize + DMA_CACHE_LINE_SIZE - 1U ) & ~( DMA_CACHE_LINE_SIZE - 1U );
+		SCB_InvalidateDCache_by_Addr( ( void * ) ulStart, ( int32_t ) ( ulEnd - ulStart ) );
+	}
+#endif
+}
+
+/*
+ * 在 HAL_Init() 之前调用。RAM_D2 里只放 DMA 用的内存：.dma_buffer（UART 表等
+ * 静态缓冲区）和 .dma_heap。仅当 DMA_HEAP_MPU_EN 为 1 时，才用一个覆盖整个
+ * RAM_D2（32KB）的 MPU 区域把两者设为 non-cacheable，链接脚本的检查也只在这时
+ * 有意义。默认为 0：不配置 MPU，RAM_D2 照常缓存，由驱动调用上面的 clean /
+ * invalidate 保持一致。DCACHE_EN 打开 D-cache。
+ */
+void vPortDmaCacheInit( void )
+{
+#if( DMA_HEAP_MPU_EN == 1 )
+	MPU_Region_InitTypeDef xRegion = { 0 };
+
+	HAL_MPU_Disable();
+	xRegion.Enable = MPU_REGION_ENABLE;
+	xRegion.Number = MPU_REGION_NUMBER0;
+	xRegion.BaseAddress = D2_AHBSRAM_BASE; /* ORIGIN(RAM_D2) */
+	xRegion.Size = MPU_REGION_SIZE_32KB;    /* LENGTH(RAM_D2) */
+	xRegion.SubRegionDisable = 0x00;
+	xRegion.TypeExtField = MPU_TEX_LEVEL1;
+	xRegion.AccessPermission = MPU_REGION_FULL_ACCESS;
+	xRegion.DisableExec = MPU_INSTRUCTION_ACCESS_DISABLE;
+	xRegion.IsShareable = MPU_ACCESS_NOT_SHAREABLE;
+	xRegion.IsCacheable = MPU_ACCESS_NOT_CACHEABLE;
+	xRegion.IsBufferable = MPU_ACCESS_NOT_BUFFERABLE;
+	HAL_MPU_ConfigRegion( &xRegion );
+	HAL_MPU_Enable( MPU_PRIVILEGED_DEFAULT );
+#endif
+
+#if( DCACHE_EN == 1 )
+	SCB_EnableDCache();
+#endif
+}
@@ -4,14 +4,23 @@
 #include "FreeRTOS.h"   /* for HeapStats_t, config macros */
 #include <stddef.h>
 
+/* Cortex-M7 D-cache 行大小，DMA 堆的块按此对齐 */
+#define DMA_CACHE_LINE_SIZE 32U
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+    /* configTOTAL_DMA_HEAP_SIZE 为 0（本工程默认）时 DMA 堆不存在，
+     * pvPortDmaMalloc 会 assert；DMA 缓冲区放在 .dma_buffer 段 */
     void *pvPortDmaMalloc( size_t xWantedSize );
     void vPortDmaFree( void *pv );
     void vPortGetDmaHeapStats( HeapStats_t *pxHeapStats );
 
+    void vPortDmaCacheClean( const void *pv, size_t xSize );
+    void vPortDmaCacheInvalidate( void *pv, size_t xSize );
+    void vPortDmaCacheInit( void );
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,42 @@
+#include "pyro_core_time.h"
+#include "FreeRTOS.h"
+#include "main.h"
+
+#define DWT_LAR_UNLOCK 0xC5ACCE55U
+
+static uint32_t time_last_cycles = 0;
+static uint64_t time_cycles_high = 0;
+
+void pyro_time_init(void)
+{
+    if (DWT->CTRL & DWT_CTRL_CYCCNTENA_Msk)
+        return;
+
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->LAR = DWT_LAR_UNLOCK; /* Cortex-M7 的 DWT 复位后处于锁定状态 */
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+    time_last_cycles = 0;
+    time_cycles_high = 0;
+}
+
+uint32_t pyro_time_cycles(void)
+{
+    return DWT->CYCCNT;
+}
+
+uint64_t pyro_time_us(void)
+{
+    UBaseType_t mask = portSET_INTERRUPT_MASK_FROM_ISR();
+
+    uint32_t cycles = DWT->CYCCNT;
+    if (cycles < time_last_cycles)
+        time_cycles_high += (uint64_t)1 << 32;
+    time_last_cycles = cycles;
+    uint64_t total = time_cycles_high | cycles;
+
+    portCLEAR_INTERRUPT_MASK_FROM_ISR(mask);
+
+    return total / (SystemCoreClock / 1000000U);
+}
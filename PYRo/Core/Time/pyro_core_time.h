@@ -0,0 +1,25 @@
+#ifndef __PYRO_CORE_TIME_H__
+#define __PYRO_CORE_TIME_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    /*
+     * 基于 DWT 周期计数器的高精度时间。
+     * - 32 位 CYCCNT 在 SystemCoreClock 下数秒即回绕，pyro_time_us() 在临界区内
+     *   检测回绕并扩展为 64 位，因此每个回绕周期内至少要调用一次（1 kHz 控制
+     *   循环或任意 CAN 接收中断都能满足）。
+     * - 任务和中断（优先级不高于 configMAX_SYSCALL_INTERRUPT_PRIORITY）中均可调用。
+     */
+    void pyro_time_init(void);
+    uint32_t pyro_time_cycles(void);
+    uint64_t pyro_time_us(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __PYRO_CORE_TIME_H__ */
@@ -0,0 +1,66 @@
+#ifndef __PYRO_TIME_HIST_H__
+#define __PYRO_TIME_HIST_H__
+
+#include <array>
+#include <cstdint>
+
+namespace pyro
+{
+
+/**
+ * @brief 以 2 为底的对数时间直方图（单位 us）
+ *
+ * bin 0 统计 [0, 2) us，bin k 统计 [2^k, 2^(k+1)) us，最后一个 bin 统计
+ * 所有更大的值。只有一个写者时计数精确，多写者时个别计数可能丢失。
+ */
+class time_hist_t
+{
+  public:
+    static constexpr uint8_t BIN_NUM = 16;
+
+    time_hist_t() : _bins(), _max_us(0)
+    {
+    }
+
+    void add(uint32_t us)
+    {
+        uint8_t bin = us < 2 ? 0 : 31 - __builtin_clz(us);
+        if (bin >= BIN_NUM)
+            bin = BIN_NUM - 1;
+        _bins[bin] = _bins[bin] + 1;
+        if (us > _max_us)
+            _max_us = us;
+    }
+
+    void reset()
+    {
+        for (auto &bin : _bins)
+            bin = 0;
+        _max_us = 0;
+    }
+
+    uint32_t get_bin(uint8_t bin) const
+    {
+        return bin < BIN_NUM ? _bins[bin] : 0;
+    }
+
+    uint32_t get_max_us() const
+    {
+        return _max_us;
+    }
+
+    uint32_t get_count() const
+    {
+        uint32_t count = 0;
+        for (auto bin : _bins)
+            count += bin;
+        return count;
+    }
+
+  private:
+    std::array<volatile uint32_t, BIN_NUM> _bins;
+    volatile uint32_t _max_us;
+};
+
+} // namespace pyro
+#endif
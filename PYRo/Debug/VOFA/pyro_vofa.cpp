@@ -1,6 +1,5 @@
 #include "pyro_vofa.h"
 
-#include "pyro_core_dma_heap.h"
 #include "task.h"
 
 #include "cstring"
@@ -9,7 +8,8 @@ namespace pyro
 {
 vofa_drv_t::vofa_drv_t(uint8_t max_length, uart_drv_t *uart)
 {
-    _data_pack = static_cast<float *>(pvPortDmaMalloc(4 * max_length));
+    // write() copies into the uart tx ring, so the frame can live anywhere
+    _data_pack = new float[max_length + 1];
     _length    = 0;
     _vofa_uart = uart;
 }
@@ -86,8 +86,12 @@ void vofa_drv_t::update_data()
 
 void vofa_drv_t::send()
 {
-    _vofa_uart->write(reinterpret_cast<uint8_t *>(_data_pack),
-                      (_length + 1) * 4);
+    // PYRO_BUSY only when the tx queue is backed up; the next tick resends
+    if (PYRO_OK != _vofa_uart->write(reinterpret_cast<uint8_t *>(_data_pack),
+                                     (_length + 1) * 4))
+    {
+        _drop_num++;
+    }
 }
 float test_data[5] = {1.1f, 2.2f, 3.3f, 4.4f, 5.5f};
 void vofa_drv_t::thread()
@@ -33,6 +33,7 @@ class vofa_drv_t
     float *_data_pack;
     uint8_t _length;
     uart_drv_t *_vofa_uart;
+    uint32_t _drop_num{}; // frames refused by a full uart tx queue
 };
 
 
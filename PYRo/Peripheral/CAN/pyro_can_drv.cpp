@@ -1,5 +1,8 @@
 #include "pyro_can_drv.h"
 #include "main.h"
+#include "pyro_can_filter.h"
+#include "pyro_can_planner.h"
+#include "pyro_core_time.h"
 
 #include <cstring>
 
@@ -7,10 +10,54 @@
 
 namespace pyro
 {
-can_msg_buffer_t::can_msg_buffer_t(uint32_t id)
-    : _id(id), _is_fresh(false), _last_update_time(0)
+static constexpr can_hub_t::bus_desc_t can_bus_table[] = {
+    {&hfdcan1, can_hub_t::can1, 32, 32, 8, 16, 4},
+    {&hfdcan2, can_hub_t::can2, 8, 3, 32, 16, 4},
+    {&hfdcan3, can_hub_t::can3, 32, 32, 32, 16, 4},
+};
+
+static constexpr bool can_bus_table_ordered(void)
+{
+    for (uint8_t i = 0; i < CAN_BUS_NUM; i++)
+    {
+        if (can_bus_table[i].which != i)
+            return false;
+    }
+    return true;
+}
+
+static_assert(sizeof(can_bus_table) / sizeof(can_bus_table[0]) ==
+                  CAN_BUS_NUM,
+              "one bus table entry per CAN_BUS_NUM");
+static_assert(can_bus_table_ordered(), "bus table must be in which_can order");
+
+// Direct indexed 11 bit id tables, kept per bus rather than per driver
+static uint8_t can_std_slot_table[CAN_BUS_NUM][0x800];
+static can_drv_t::tx_ring_t
+    can_tx_ring_table[CAN_BUS_NUM][can_drv_t::tx_prio_num];
+#if CAN_RX_DEFERRED_EN
+static can_drv_t::rx_ring_t can_rx_ring_table[CAN_BUS_NUM];
+// Drivers in deferred mode, indexed by bus, drained by the rx task
+static can_drv_t *can_rx_deferred_drv[CAN_BUS_NUM];
+static TaskHandle_t can_rx_task_handle;
+static StackType_t can_rx_task_stack[CAN_RX_TASK_STACK_SIZE];
+static StaticTask_t can_rx_task_tcb;
+#endif
+static TaskHandle_t can_monitor_task_handle;
+static StackType_t can_monitor_stack[CAN_MONITOR_STACK_SIZE];
+static StaticTask_t can_monitor_tcb;
+
+// Defined after the tables above, constructed before main
+static can_drv_t can_drv_table[CAN_BUS_NUM] = {
+    can_drv_t(&hfdcan1),
+    can_drv_t(&hfdcan2),
+    can_drv_t(&hfdcan3),
+};
+
+can_msg_buffer_t::can_msg_buffer_t(uint32_t id, bool extended)
+    : _id(id), _extended(extended), _is_fresh(false), _notify_group(nullptr),
+      _notify_bit(0), _history(nullptr), _next(nullptr)
 {
-    _buffer.fill(0);
     //_mtx = xSemaphoreCreateMutex();
 }
 
@@ -24,6 +71,11 @@ uint32_t can_msg_buffer_t::get_id(void)
     return _id;
 }
 
+bool can_msg_buffer_t::is_extended(void)
+{
+    return _extended;
+}
+
 bool can_msg_buffer_t::is_fresh(void)
 {
     return _is_fresh;
@@ -37,33 +89,275 @@ void can_msg_buffer_t::mark_read(void)
     //}
 }
 
-void can_msg_buffer_t::update_data(const uint8_t *data) // Mutex or not
+// Single writer: only the rx path of the owning bus calls this
+void can_msg_buffer_t::update_data(const uint8_t *data, uint8_t len,
+                                   uint64_t rx_us)
 {
-    // if(xSemaphoreTake(_mtx,portMAX_DELAY)==pdTRUE){
-    memcpy(_buffer.data(), data, 8);
-    _last_update_time = xTaskGetTickCount();
-    _is_fresh         = true;
-    // xSemaphoreGive(_mtx);
-    // }
+    if (len > CAN_MAX_DATA_LEN)
+        len = CAN_MAX_DATA_LEN;
+
+    uint64_t now_us = rx_us ? rx_us : pyro_time_us();
+
+    frame_t &frame = _frame.write_begin();
+#if CAN_RX_LATENCY_HIST_EN
+    // Writer side, so the previous timestamp can be read without the lock
+    if (frame.timestamp_us)
+        _interval_hist.add(static_cast<uint32_t>(now_us - frame.timestamp_us));
+#endif
+    memcpy(frame.data.data(), data, len);
+    frame.len          = len;
+    frame.timestamp    = xTaskGetTickCountFromISR();
+    frame.timestamp_us = now_us;
+    if (_history)
+        _history->push(frame);
+    _frame.write_end();
+    _is_fresh = true;
+    if (_notify_group)
+        _notify_group->notify(_notify_bit);
+}
+
+void can_msg_buffer_t::set_notify(can_notify_group_t *group, uint32_t bit)
+{
+    taskENTER_CRITICAL();
+    _notify_group = group;
+    _notify_bit   = bit;
+    taskEXIT_CRITICAL();
+}
+
+void can_msg_buffer_t::attach_history(can_history_t *history)
+{
+    taskENTER_CRITICAL();
+    _history = history;
+    taskEXIT_CRITICAL();
+}
+
+can_history_t *can_msg_buffer_t::get_history(void)
+{
+    return _history;
 }
 
+// Lock free, retries while the rx interrupt is writing. Returns false only
+// if every retry raced a write, data is left untouched in that case
 bool can_msg_buffer_t::get_data(std::array<uint8_t, 8> &data)
 {
-    // if(xSemaphoreTake(_mtx,portMAX_DELAY)==pdTRUE){
-    memcpy(data.data(), _buffer.data(), 8);
-    // xSemaphoreGive(_mtx);
+    frame_t frame;
+    if (!get_frame(frame))
+        return false;
+    memcpy(data.data(), frame.data.data(), 8);
     return true;
-    // }
-    // return false;
 }
 
+bool can_msg_buffer_t::get_data(uint8_t *data, uint8_t &len)
+{
+    frame_t frame;
+    if (!get_frame(frame))
+        return false;
+    if (frame.len < len)
+        len = frame.len;
+    memcpy(data, frame.data.data(), len);
+    return true;
+}
+
+bool can_msg_buffer_t::get_frame(frame_t &frame)
+{
+    if (!_frame.read(frame))
+        return false;
+    record_age(frame.timestamp_us);
+    return true;
+}
+
+void can_msg_buffer_t::record_age(uint64_t timestamp_us)
+{
+#if CAN_RX_LATENCY_HIST_EN
+    if (timestamp_us)
+        _age_hist.add(static_cast<uint32_t>(pyro_time_us() - timestamp_us));
+#endif
+}
+
+TickType_t can_msg_buffer_t::get_last_update_time(void)
+{
+    frame_t frame{};
+    _frame.read(frame);
+    return frame.timestamp;
+}
+
+uint64_t can_msg_buffer_t::get_last_update_us(void)
+{
+    frame_t frame{};
+    _frame.read(frame);
+    return frame.timestamp_us;
+}
+
+// UINT32_MAX if nothing has been received yet
+uint32_t can_msg_buffer_t::get_age_us(void)
+{
+    uint64_t last_us = get_last_update_us();
+    if (!last_us)
+        return UINT32_MAX;
+    return static_cast<uint32_t>(pyro_time_us() - last_us);
+}
+
+#if CAN_RX_LATENCY_HIST_EN
+const time_hist_t &can_msg_buffer_t::get_interval_hist(void)
+{
+    return _interval_hist;
+}
+
+const time_hist_t &can_msg_buffer_t::get_age_hist(void)
+{
+    return _age_hist;
+}
+
+void can_msg_buffer_t::reset_hist(void)
+{
+    _interval_hist.reset();
+    _age_hist.reset();
+}
+#endif
+
 
 
+can_history_t::can_history_t(entry_t *entries, uint16_t depth)
+    : _entries(entries), _depth(depth), _count(0)
+{
+    for (uint16_t i = 0; i < _depth; i++)
+        _entries[i].seq.store(0, std::memory_order_relaxed);
+}
+
+void can_history_t::push(const frame_t &frame)
+{
+    uint32_t pos   = _count.load(std::memory_order_relaxed);
+    entry_t &entry = _entries[pos % _depth];
+    entry.seq.store(2 * pos + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    entry.frame = frame;
+    entry.seq.store(2 * pos + 2, std::memory_order_release);
+    _count.store(pos + 1, std::memory_order_release);
+}
+
+bool can_history_t::read(uint16_t back, frame_t &frame) const
+{
+    uint32_t count = _count.load(std::memory_order_acquire);
+    if (back >= _depth || back >= count)
+        return false;
+
+    uint32_t pos         = count - 1 - back;
+    const entry_t &entry = _entries[pos % _depth];
+    if (entry.seq.load(std::memory_order_acquire) != 2 * pos + 2)
+        return false;
+    frame = entry.frame;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return entry.seq.load(std::memory_order_relaxed) == 2 * pos + 2;
+}
+
+uint16_t can_history_t::read_latest(frame_t *frames, uint16_t num) const
+{
+    uint16_t i = 0;
+    while (i < num && read(i, frames[i]))
+        i++;
+    return i;
+}
+
+uint32_t can_history_t::get_count(void) const
+{
+    return _count.load(std::memory_order_acquire);
+}
+
+uint16_t can_history_t::get_depth(void) const
+{
+    return _depth;
+}
+
+can_notify_group_t::can_notify_group_t()
+    : _task(nullptr), _all_mask(0), _received(0), _num(0)
+{
+}
+
+can_notify_group_t::~can_notify_group_t()
+{
+}
+
+status_t can_notify_group_t::bind_current_task(void)
+{
+    _task = xTaskGetCurrentTaskHandle();
+    return _task ? PYRO_OK : PYRO_ERROR;
+}
+
+status_t can_notify_group_t::add(can_msg_buffer_t *msg)
+{
+    if (nullptr == msg)
+        return PYRO_PARAM_ERROR;
+    if (_num >= MAX_NUM)
+        return PYRO_NO_MEMORY;
+    uint32_t bit = 1U << _num++;
+    _all_mask |= bit;
+    msg->set_notify(this, bit);
+    return PYRO_OK;
+}
+
+// Runs in the rx interrupt, or in task context when frames are dispatched
+// from a task
+void can_notify_group_t::notify(uint32_t bit)
+{
+    TaskHandle_t task = _task;
+    if (nullptr == task)
+        return;
+    if (xPortIsInsideInterrupt())
+    {
+        BaseType_t woken = pdFALSE;
+        xTaskNotifyFromISR(task, bit, eSetBits, &woken);
+        portYIELD_FROM_ISR(woken);
+    }
+    else
+    {
+        xTaskNotify(task, bit, eSetBits);
+    }
+}
+
+status_t can_notify_group_t::wait_all(TickType_t timeout, uint32_t *received)
+{
+    TimeOut_t time_out;
+    vTaskSetTimeOutState(&time_out);
+
+    while ((_received & _all_mask) != _all_mask)
+    {
+        uint32_t bits = 0;
+        // Bits that arrived before the wait are kept, consumed ones cleared
+        if (pdTRUE != xTaskNotifyWait(0, _all_mask, &bits, timeout))
+            break;
+        _received |= bits;
+        if (pdTRUE == xTaskCheckForTimeOut(&time_out, &timeout))
+            break;
+    }
+
+    if (received)
+        *received = _received;
+    if ((_received & _all_mask) != _all_mask)
+        return PYRO_TIMEOUT;
+    _received = 0;
+    return PYRO_OK;
+}
+
 can_drv_t::can_drv_t(FDCAN_HandleTypeDef *hfdcan)
+    : _rx_buf_num(0), _rx_header(),
+      _rx_stats(), _rx_mode(rx_mode_immediate), _rx_ring(nullptr),
+      _rx_pending(false), _tx_stats(), _tx_gate_num(0),
+      _last_tx_complete_us(0),
+      _tx_event_en(false), _tx_marker(0), _tx_latency(), _health(),
+      _nom_bit_ns(1000), _data_bit_ns(1000), _rx_frame_acc(0),
+      _tx_frame_acc(0), _busy_ns_acc(0), _poll_us(0), _recover_tick(0),
+      _ts_en(false), _ts_last(0), _ts_last_us(0), _ts_win_us(0),
+      _ts_win_ticks(0), _time_sync()
 {
     _hfdcan = hfdcan;
-    _registerlist.clear();
-    //_registermtx = xSemaphoreCreateMutex();
+
+    int8_t bus = can_hub_t::bus_index(hfdcan);
+    _bus       = bus;
+    _tx_ring   = bus < 0 ? nullptr : can_tx_ring_table[bus];
+    _rx_table.attach(bus < 0 ? nullptr : can_std_slot_table[bus]);
+    _rx_buf_msgs.fill(nullptr);
+    _tx_buf_ns.fill(0);
+    _tx_marks.fill({0, 0, 0, 0, 0, false});
 }
 
 can_drv_t::~can_drv_t(void)
@@ -73,22 +367,80 @@ can_drv_t::~can_drv_t(void)
 
 pyro::status_t can_drv_t::init(void)
 {
-    FDCAN_FilterTypeDef fdcan_filter;
-    fdcan_filter.IdType       = FDCAN_STANDARD_ID;
-    fdcan_filter.FilterIndex  = 0;
-    fdcan_filter.FilterType   = FDCAN_FILTER_MASK;
-    fdcan_filter.FilterConfig = FDCAN_FILTER_TO_RXFIFO0;
-    fdcan_filter.FilterID1    = 0x00;
-    fdcan_filter.FilterID2    = 0x00;
-
-    if (HAL_OK != HAL_FDCAN_ConfigFilter(_hfdcan, &fdcan_filter))
+    if (_bus < 0)
+        return pyro::PYRO_PARAM_ERROR;
+    const can_hub_t::bus_desc_t *desc = can_hub_t::get_bus_desc(_bus);
+    if (_hfdcan->Init.RxFifo0ElmtsNbr != desc->rx_fifo0_num ||
+        _hfdcan->Init.RxBuffersNbr != desc->rx_buffer_num ||
+        _hfdcan->Init.TxFifoQueueElmtsNbr != desc->tx_fifo_num ||
+        _hfdcan->Init.StdFiltersNbr != desc->std_filter_num ||
+        _hfdcan->Init.ExtFiltersNbr != desc->ext_filter_num)
+        return pyro::PYRO_PARAM_ERROR;
+
+    // Without filter elements for an id type everything is taken in and
+    // handle_rx_msg does the rejecting.
+    uint32_t non_matching_std = _hfdcan->Init.StdFiltersNbr
+                                    ? FDCAN_REJECT
+                                    : FDCAN_ACCEPT_IN_RX_FIFO0;
+    uint32_t non_matching_ext = _hfdcan->Init.ExtFiltersNbr
+                                    ? FDCAN_REJECT
+                                    : FDCAN_ACCEPT_IN_RX_FIFO0;
+
+    if (pyro::PYRO_OK != update_filters())
         return pyro::PYRO_ERROR;
-    if (HAL_OK !=
-        HAL_FDCAN_ConfigGlobalFilter(_hfdcan, FDCAN_REJECT, FDCAN_REJECT,
-                                     FDCAN_REJECT_REMOTE, FDCAN_REJECT_REMOTE))
+    if (HAL_OK != HAL_FDCAN_ConfigGlobalFilter(_hfdcan, non_matching_std,
+                                               non_matching_ext,
+                                               FDCAN_REJECT_REMOTE,
+                                               FDCAN_REJECT_REMOTE))
         return pyro::PYRO_ERROR;
     if (HAL_OK != HAL_FDCAN_ConfigFifoWatermark(_hfdcan, FDCAN_CFG_RX_FIFO0, 1))
         return pyro::PYRO_ERROR;
+    uint64_t fdcan_clk = HAL_RCCEx_GetPeriphCLKFreq(RCC_PERIPHCLK_FDCAN);
+    if (fdcan_clk)
+    {
+        _nom_bit_ns = 1000000000ULL * _hfdcan->Init.NominalPrescaler *
+                      (1 + _hfdcan->Init.NominalTimeSeg1 +
+                       _hfdcan->Init.NominalTimeSeg2) /
+                      fdcan_clk;
+        _data_bit_ns = 1000000000ULL * _hfdcan->Init.DataPrescaler *
+                       (1 + _hfdcan->Init.DataTimeSeg1 +
+                        _hfdcan->Init.DataTimeSeg2) /
+                       fdcan_clk;
+    }
+    can_planner_t::get_instance()->set_bit_time(_bus, _nom_bit_ns,
+                                                _data_bit_ns);
+
+    // Above 1 Mbit the transceiver loop delay exceeds the data bit time,
+    // the secondary sample point is put at the data phase sample point
+    if (FDCAN_FRAME_FD_BRS == _hfdcan->Init.FrameFormat)
+    {
+        uint32_t tdc_offset = _hfdcan->Init.DataPrescaler *
+                              (_hfdcan->Init.DataTimeSeg1 + 1);
+        if (HAL_OK !=
+            HAL_FDCAN_ConfigTxDelayCompensation(_hfdcan, tdc_offset, 0))
+            return pyro::PYRO_ERROR;
+        if (HAL_OK != HAL_FDCAN_EnableTxDelayCompensation(_hfdcan))
+            return pyro::PYRO_ERROR;
+    }
+
+    // Rx elements and tx events carry the timestamp counter at start of
+    // frame, counted in nominal bit times. With bit rate switching the
+    // internal counter also counts through the data phase and is no fixed
+    // time base, and there is no TIM3 for the external one, so BRS buses
+    // take rx times and tx event times from the DWT clock in the isr.
+    _tx_event_en = CAN_TX_EVENT_EN && _hfdcan->Init.TxEventsNbr > 0;
+    _ts_en       = (CAN_TIME_SYNC_EN || _tx_event_en) &&
+                   FDCAN_FRAME_FD_BRS != _hfdcan->Init.FrameFormat;
+    _time_sync.scale_q16 = _nom_bit_ns << 16;
+    if (_ts_en)
+    {
+        if (HAL_OK != HAL_FDCAN_ConfigTimestampCounter(_hfdcan,
+                                                       FDCAN_TIMESTAMP_PRESC_1))
+            return pyro::PYRO_ERROR;
+        if (HAL_OK != HAL_FDCAN_EnableTimestampCounter(_hfdcan,
+                                                       FDCAN_TIMESTAMP_INTERNAL))
+            return pyro::PYRO_ERROR;
+    }
     if (pyro::PYRO_OK !=
         pyro::can_hub_t::get_instance()->hub_register_can_obj(_hfdcan, this))
         return pyro::PYRO_ERROR;
@@ -101,168 +453,1272 @@ pyro::status_t can_drv_t::start(void)
     if (HAL_OK != HAL_FDCAN_Start(_hfdcan))
         return pyro::PYRO_ERROR;
     if (HAL_OK != HAL_FDCAN_ActivateNotification(
-                      _hfdcan, FDCAN_IT_RX_FIFO0_NEW_MESSAGE, 0))
+                      _hfdcan,
+                      FDCAN_IT_RX_FIFO0_NEW_MESSAGE | FDCAN_IT_RX_FIFO0_FULL |
+                          FDCAN_IT_RX_FIFO0_MESSAGE_LOST |
+                          FDCAN_IT_RX_BUFFER_NEW_MESSAGE,
+                      0))
+        return pyro::PYRO_ERROR;
+    if (HAL_OK != HAL_FDCAN_ActivateNotification(
+                      _hfdcan,
+                      FDCAN_IT_BUS_OFF | FDCAN_IT_ERROR_PASSIVE |
+                          FDCAN_IT_ERROR_WARNING,
+                      0))
+        return pyro::PYRO_ERROR;
+    // Every finished transmission frees a fifo element, refill from there
+    uint32_t tx_num =
+        _hfdcan->Init.TxBuffersNbr + _hfdcan->Init.TxFifoQueueElmtsNbr;
+    uint32_t tx_buffers = tx_num >= 32 ? 0xFFFFFFFFU : (1U << tx_num) - 1U;
+    if (HAL_OK != HAL_FDCAN_ActivateNotification(
+                      _hfdcan, FDCAN_IT_TX_COMPLETE, tx_buffers))
+        return pyro::PYRO_ERROR;
+    if (_tx_event_en &&
+        HAL_OK != HAL_FDCAN_ActivateNotification(
+                      _hfdcan,
+                      FDCAN_IT_TX_EVT_FIFO_NEW_DATA |
+                          FDCAN_IT_TX_EVT_FIFO_ELT_LOST,
+                      0))
         return pyro::PYRO_ERROR;
     return pyro::PYRO_OK;
 }
 
-pyro::status_t can_drv_t::send_msg(uint32_t id, uint8_t *data)
+// Never blocks: the frame is queued in software and moved into the hardware
+// fifo right away if there is room, otherwise from the tx complete interrupt
+pyro::status_t can_drv_t::send_msg(uint32_t id, uint8_t *data,
+                                   tx_prio_t prio)
+{
+    return send_msg(id, data, 8, 0, prio);
+}
+
+// Lengths that are not a valid FD length are padded with zeros up to the
+// next one
+pyro::status_t can_drv_t::send_msg(uint32_t id, const uint8_t *data,
+                                   uint8_t len, uint8_t flags, tx_prio_t prio)
+{
+    if (prio >= tx_prio_num || len > CAN_MAX_DATA_LEN)
+        return pyro::PYRO_PARAM_ERROR;
+    if (len > 8 && !(flags & tx_flag_fd))
+        return pyro::PYRO_PARAM_ERROR;
+    if ((flags & tx_flag_fd) &&
+        FDCAN_FRAME_CLASSIC == _hfdcan->Init.FrameFormat)
+        return pyro::PYRO_PARAM_ERROR;
+    if ((flags & tx_flag_brs) &&
+        FDCAN_FRAME_FD_BRS != _hfdcan->Init.FrameFormat)
+        return pyro::PYRO_PARAM_ERROR;
+
+    tx_frame_t frame;
+    frame.id         = id;
+    frame.len        = dlc_to_len(len_to_dlc(len));
+    frame.flags      = flags;
+    frame.enqueue_us = static_cast<uint32_t>(pyro_time_us());
+    if (frame.len > elmt_size_to_len(_hfdcan->Init.TxElmtSize))
+        return pyro::PYRO_PARAM_ERROR;
+    memcpy(frame.data, data, len);
+    memset(frame.data + len, 0, frame.len - len);
+
+    tx_gate_t *gate = find_tx_gate(id);
+    if (gate && (flags & tx_flag_no_gate))
+        tx_gate_bypass(gate);
+    else if (gate && pyro::PYRO_OK != tx_gate_admit(gate, frame, prio))
+        return pyro::PYRO_OK;
+
+    if (!_tx_ring)
+    {
+        UBaseType_t mask      = portSET_INTERRUPT_MASK_FROM_ISR();
+        HAL_StatusTypeDef ret = tx_write(frame);
+        portCLEAR_INTERRUPT_MASK_FROM_ISR(mask);
+        if (HAL_OK != ret)
+            tx_gate_revoke(gate);
+        return HAL_OK == ret ? pyro::PYRO_OK : pyro::PYRO_ERROR;
+    }
+
+    if (!_tx_ring[prio].push(frame))
+    {
+        UBaseType_t mask = portSET_INTERRUPT_MASK_FROM_ISR();
+        _tx_stats.overflow_num[prio]++;
+        portCLEAR_INTERRUPT_MASK_FROM_ISR(mask);
+        tx_gate_revoke(gate);
+        tx_pump();
+        return pyro::PYRO_BUSY;
+    }
+
+    tx_pump();
+    return pyro::PYRO_OK;
+}
+
+pyro::status_t can_drv_t::set_tx_policy(uint32_t id, uint16_t keepalive_ms,
+                                        uint32_t min_interval_us)
+{
+    UBaseType_t mask = portSET_INTERRUPT_MASK_FROM_ISR();
+    tx_gate_t *gate  = find_tx_gate(id);
+    if (nullptr == gate)
+    {
+        if (_tx_gate_num >= CAN_TX_GATE_NUM)
+        {
+            portCLEAR_INTERRUPT_MASK_FROM_ISR(mask);
+            return pyro::PYRO_NO_MEMORY;
+        }
+        gate        = &_tx_gates[_tx_gate_num];
+        *gate       = {};
+        gate->id    = id;
+        _tx_gate_num++;
+    }
+    gate->keepalive_ms    = keepalive_ms;
+    gate->min_interval_us = min_interval_us;
+    portCLEAR_INTERRUPT_MASK_FROM_ISR(mask);
+    return pyro::PYRO_OK;
+}
+
+pyro::status_t can_drv_t::get_tx_gate_stats(uint32_t id,
+                                            tx_gate_stats_t &stats)
+{
+    tx_gate_t *gate = find_tx_gate(id);
+    if (nullptr == gate)
+        return pyro::PYRO_NOT_FOUND;
+    stats = gate->stats;
+    return pyro::PYRO_OK;
+}
+
+// Gates are only ever appended, so the lookup needs no lock
+can_drv_t::tx_gate_t *can_drv_t::find_tx_gate(uint32_t id)
+{
+    for (uint8_t i = 0; i < _tx_gate_num; i++)
+    {
+        if (_tx_gates[i].id == id)
+            return &_tx_gates[i];
+    }
+    return nullptr;
+}
+
+// PYRO_OK to send, recorded as the last frame sent. PYRO_NOT_FOUND if the
+// frame is unchanged and not yet due, PYRO_BUSY if it comes too soon and
+// is kept in the gate until tx_gate_release sends it.
+pyro::status_t can_drv_t::tx_gate_admit(tx_gate_t *gate,
+                                        const tx_frame_t &frame,
+                                        tx_prio_t prio)
+{
+    pyro::status_t ret = pyro::PYRO_OK;
+    UBaseType_t mask   = portSET_INTERRUPT_MASK_FROM_ISR();
+    uint32_t since_us  = frame.enqueue_us - gate->last_us;
+
+    // Whatever is decided, a delayed frame is older than this one
+    if (gate->held)
+    {
+        gate->held = false;
+        gate->stats.merge_num++;
+        _tx_stats.merge_num++;
+    }
+    if (gate->sent && gate->keepalive_ms && gate->len == frame.len &&
+        0 == memcmp(gate->data, frame.data, frame.len) &&
+        since_us < gate->keepalive_ms * 1000U)
+    {
+        gate->stats.unchanged_num++;
+        _tx_stats.unchanged_num++;
+        ret = pyro::PYRO_NOT_FOUND;
+    }
+    else if (gate->sent && since_us < gate->min_interval_us)
+    {
+        gate->held       = true;
+        gate->held_prio  = prio;
+        gate->held_frame = frame;
+        gate->stats.rate_num++;
+        _tx_stats.rate_num++;
+        ret = pyro::PYRO_BUSY;
+    }
+    else
+    {
+        gate->stats.sent_num++;
+        gate->sent    = true;
+        gate->last_us = frame.enqueue_us;
+        gate->len     = frame.len;
+        memcpy(gate->data, frame.data, frame.len);
+    }
+    portCLEAR_INTERRUPT_MASK_FROM_ISR(mask);
+    return ret;
+}
+
+// A state change goes out now; a delayed frame from before it is stale, and
+// the frame after it must not be compared against it
+void can_drv_t::tx_gate_bypass(tx_gate_t *gate)
+{
+    UBaseType_t mask = portSET_INTERRUPT_MASK_FROM_ISR();
+    if (gate->held)
+    {
+        gate->held = false;
+        gate->stats.merge_num++;
+        _tx_stats.merge_num++;
+    }
+    gate->sent = false;
+    portCLEAR_INTERRUPT_MASK_FROM_ISR(mask);
+}
+
+// The admitted frame never made it into a queue, let the next one through
+void can_drv_t::tx_gate_revoke(tx_gate_t *gate)
+{
+    if (gate)
+        gate->sent = false;
+}
+
+// Queues the delayed frames whose interval is up. Called from tx_pump with
+// interrupts masked; a frame that finds its queue full stays held.
+void can_drv_t::tx_gate_release(void)
+{
+    uint32_t now_us = 0;
+    for (uint8_t i = 0; i < _tx_gate_num; i++)
+    {
+        tx_gate_t &gate = _tx_gates[i];
+        if (!gate.held)
+            continue;
+        if (!now_us)
+            now_us = static_cast<uint32_t>(pyro_time_us());
+        if (now_us - gate.last_us < gate.min_interval_us ||
+            !_tx_ring[gate.held_prio].push(gate.held_frame))
+            continue;
+        gate.held = false;
+        gate.stats.sent_num++;
+        gate.last_us = now_us;
+        gate.len     = gate.held_frame.len;
+        memcpy(gate.data, gate.held_frame.data, gate.held_frame.len);
+    }
+}
+
+void can_drv_t::tx_poll(void)
+{
+    if (_tx_ring)
+        tx_pump();
+}
+
+void can_drv_t::handle_tx_complete(uint32_t buffer_indexes)
+{
+    _last_tx_complete_us = pyro_time_us();
+    while (buffer_indexes)
+    {
+        uint32_t index = __builtin_ctz(buffer_indexes);
+        buffer_indexes &= buffer_indexes - 1;
+        _tx_frame_acc++;
+        _busy_ns_acc += _tx_buf_ns[index];
+    }
+    tx_pump();
+}
+
+uint64_t can_drv_t::get_last_tx_complete_us(void)
+{
+    UBaseType_t mask = portSET_INTERRUPT_MASK_FROM_ISR();
+    uint64_t us      = _last_tx_complete_us;
+    portCLEAR_INTERRUPT_MASK_FROM_ISR(mask);
+    return us;
+}
+
+const can_drv_t::tx_stats_t &can_drv_t::get_tx_stats(void)
+{
+    return _tx_stats;
+}
+
+// HAL access and the consumer side of the rings are serialized by masking
+// interrupts up to configMAX_SYSCALL_INTERRUPT_PRIORITY, which also covers
+// the tx complete interrupt of this bus.
+void can_drv_t::tx_pump(void)
+{
+    UBaseType_t mask = portSET_INTERRUPT_MASK_FROM_ISR();
+
+    tx_gate_release();
+
+    uint32_t queued = _tx_ring[tx_prio_high].size() +
+                      _tx_ring[tx_prio_low].size();
+    if (queued > _tx_stats.queue_max)
+        _tx_stats.queue_max = queued;
+
+    tx_frame_t frame;
+    while (HAL_FDCAN_GetTxFifoFreeLevel(_hfdcan) > 0)
+    {
+        if (!_tx_ring[tx_prio_high].pop(frame) &&
+            !_tx_ring[tx_prio_low].pop(frame))
+            break;
+        if (HAL_OK == tx_write(frame))
+            _tx_stats.sent_num++;
+        else
+            _tx_stats.drop_num++;
+    }
+
+    portCLEAR_INTERRUPT_MASK_FROM_ISR(mask);
+}
+
+HAL_StatusTypeDef can_drv_t::tx_write(const tx_frame_t &frame)
 {
     FDCAN_TxHeaderTypeDef tx_header;
-    // if(xSemaphoreTake(_registermtx,portMAX_DELAY)==pdTRUE){
     tx_header.IdType              = FDCAN_STANDARD_ID;
-    tx_header.Identifier          = id;
+    tx_header.Identifier          = frame.id;
     tx_header.TxFrameType         = FDCAN_DATA_FRAME;
-    tx_header.DataLength          = 8;
+    tx_header.DataLength          = len_to_dlc(frame.len);
     tx_header.ErrorStateIndicator = FDCAN_ESI_ACTIVE;
-    tx_header.BitRateSwitch       = FDCAN_BRS_OFF;
-    tx_header.FDFormat            = FDCAN_CLASSIC_CAN;
-    tx_header.TxEventFifoControl  = FDCAN_NO_TX_EVENTS;
-    tx_header.MessageMarker       = 0;
+    tx_header.BitRateSwitch =
+        (frame.flags & tx_flag_brs) ? FDCAN_BRS_ON : FDCAN_BRS_OFF;
+    tx_header.FDFormat =
+        (frame.flags & tx_flag_fd) ? FDCAN_FD_CAN : FDCAN_CLASSIC_CAN;
+    tx_header.TxEventFifoControl =
+        _tx_event_en ? FDCAN_STORE_TX_EVENTS : FDCAN_NO_TX_EVENTS;
+    tx_header.MessageMarker = _tx_marker;
+
+    HAL_StatusTypeDef ret =
+        HAL_FDCAN_AddMessageToTxFifoQ(_hfdcan, &tx_header, frame.data);
+    if (HAL_OK == ret)
+    {
+        uint32_t index = __builtin_ctz(
+            HAL_FDCAN_GetLatestTxFifoQRequestBuffer(_hfdcan));
+        _tx_buf_ns[index & 31] =
+            frame_ns(frame.len, false, frame.flags & tx_flag_fd,
+                     frame.flags & tx_flag_brs);
+        if (_tx_event_en)
+        {
+            tx_mark_t &mark = _tx_marks[_tx_marker & 31];
+            mark.enqueue_us = frame.enqueue_us;
+            mark.write_us   = static_cast<uint32_t>(pyro_time_us());
+            mark.write_ts   =
+                _ts_en ? HAL_FDCAN_GetTimestampCounter(_hfdcan) : 0;
+            mark.frame_ns   = _tx_buf_ns[index & 31];
+            mark.marker     = _tx_marker;
+            mark.pending    = true;
+            _tx_marker++;
+        }
+    }
+    return ret;
+}
+
+void can_drv_t::handle_tx_event(uint32_t tx_event_its)
+{
+    if (tx_event_its & FDCAN_IT_TX_EVT_FIFO_ELT_LOST)
+        _tx_latency.lost_num++;
+
+    FDCAN_TxEventFifoTypeDef event;
+    uint32_t now_us = static_cast<uint32_t>(pyro_time_us());
+    while ((_hfdcan->Instance->TXEFS & FDCAN_TXEFS_EFFL) &&
+           HAL_OK == HAL_FDCAN_GetTxEvent(_hfdcan, &event))
+    {
+        _tx_latency.event_num++;
+        tx_mark_t &mark = _tx_marks[event.MessageMarker & 31];
+        if (!mark.pending || mark.marker != event.MessageMarker)
+        {
+            _tx_latency.unmatched_num++;
+            continue;
+        }
+        mark.pending = false;
+
+        // Both counters wrap, the differences are still right
+        uint32_t queue_us = mark.write_us - mark.enqueue_us;
+        uint32_t arb_us;
+        if (_ts_en)
+        {
+            uint16_t ticks =
+                static_cast<uint16_t>(event.TxTimestamp - mark.write_ts);
+            arb_us = ticks * _nom_bit_ns / 1000;
+        }
+        else
+        {
+            // Isr time less the frame, so an upper bound that includes the
+            // interrupt latency
+            uint32_t sent_us = now_us - mark.write_us;
+            uint32_t bus_us  = mark.frame_ns / 1000;
+            arb_us           = sent_us > bus_us ? sent_us - bus_us : 0;
+        }
+        _tx_latency.queue_hist.add(queue_us);
+        _tx_latency.arb_hist.add(arb_us);
+        if (queue_us > _tx_latency.queue_max_us)
+            _tx_latency.queue_max_us = queue_us;
+        if (arb_us > _tx_latency.arb_max_us)
+            _tx_latency.arb_max_us = arb_us;
+    }
+}
+
+const can_drv_t::tx_latency_t &can_drv_t::get_tx_latency(void)
+{
+    return _tx_latency;
+}
+
+void can_drv_t::reset_tx_latency(void)
+{
+    UBaseType_t mask = portSET_INTERRUPT_MASK_FROM_ISR();
+    _tx_latency.event_num     = 0;
+    _tx_latency.unmatched_num = 0;
+    _tx_latency.lost_num      = 0;
+    _tx_latency.queue_max_us  = 0;
+    _tx_latency.arb_max_us    = 0;
+    _tx_latency.queue_hist.reset();
+    _tx_latency.arb_hist.reset();
+    portCLEAR_INTERRUPT_MASK_FROM_ISR(mask);
+}
+
+uint32_t can_drv_t::frame_bits(uint8_t len, bool extended, bool fd,
+                               uint32_t *data_bits)
+{
+    return can_planner_t::frame_bits(len, extended, fd, data_bits);
+}
+
+uint32_t can_drv_t::frame_ns(uint8_t len, bool extended, bool fd, bool brs)
+{
+    uint32_t fast;
+    uint32_t bits = frame_bits(len, extended, fd, &fast);
+    if (!brs)
+        return bits * _nom_bit_ns;
+    return (bits - fast) * _nom_bit_ns + fast * _data_bit_ns;
+}
+
+void can_drv_t::account_rx_frame(void)
+{
+    _rx_frame_acc++;
+    _busy_ns_acc += frame_ns(dlc_to_len(_rx_header.DataLength),
+                             FDCAN_EXTENDED_ID == _rx_header.IdType,
+                             FDCAN_FD_CAN == _rx_header.FDFormat,
+                             FDCAN_BRS_ON == _rx_header.BitRateSwitch);
+}
+
+// Error status interrupts fire on every change of the flag, count entries
+void can_drv_t::handle_error_status(uint32_t error_status_its)
+{
+    uint32_t psr = _hfdcan->Instance->PSR;
+    if ((error_status_its & FDCAN_IT_ERROR_WARNING) && (psr & FDCAN_PSR_EW))
+        _health.warning_num++;
+    if ((error_status_its & FDCAN_IT_ERROR_PASSIVE) && (psr & FDCAN_PSR_EP))
+        _health.passive_num++;
+    if ((error_status_its & FDCAN_IT_BUS_OFF) && (psr & FDCAN_PSR_BO))
+        _health.bus_off_num++;
+}
+
+pyro::status_t can_drv_t::health_poll(void)
+{
+    FDCAN_ProtocolStatusTypeDef protocol;
+    FDCAN_ErrorCountersTypeDef counters;
+
+    uint64_t now_us  = pyro_time_us();
+    UBaseType_t mask = portSET_INTERRUPT_MASK_FROM_ISR();
+    uint32_t rx_num  = _rx_frame_acc;
+    uint32_t tx_num  = _tx_frame_acc;
+    uint32_t busy_ns = _busy_ns_acc;
+    _rx_frame_acc    = 0;
+    _tx_frame_acc    = 0;
+    _busy_ns_acc     = 0;
+    portCLEAR_INTERRUPT_MASK_FROM_ISR(mask);
 
-    if (HAL_OK != HAL_FDCAN_AddMessageToTxFifoQ(_hfdcan, &tx_header, data))
+    uint32_t window_us = static_cast<uint32_t>(now_us - _poll_us);
+    if (_poll_us && window_us)
     {
-        // xSemaphoreGive(_registermtx);
+        _health.rx_fps = static_cast<uint64_t>(rx_num) * 1000000 / window_us;
+        _health.tx_fps = static_cast<uint64_t>(tx_num) * 1000000 / window_us;
+        _health.load_permille = busy_ns / window_us;
+    }
+    _poll_us              = now_us;
+    _health.fifo_lost_num = _rx_stats.fifo_lost_num;
+
+    if (HAL_OK != HAL_FDCAN_GetProtocolStatus(_hfdcan, &protocol) ||
+        HAL_OK != HAL_FDCAN_GetErrorCounters(_hfdcan, &counters))
         return pyro::PYRO_ERROR;
+    _health.tec = counters.TxErrorCnt;
+    _health.rec = counters.RxErrorCnt;
+
+    TickType_t now = xTaskGetTickCount();
+    if (protocol.BusOff)
+    {
+        // The controller sets INIT on bus-off and stays there until software
+        // clears it, then waits 129 x 11 recessive bits before rejoining
+        if (bus_recovering != _health.state)
+        {
+            _health.state      = bus_recovering;
+            _health.backoff_ms = CAN_RECOVER_MIN_MS;
+            _recover_tick      = now + pdMS_TO_TICKS(_health.backoff_ms);
+        }
+        else if (static_cast<int32_t>(now - _recover_tick) >= 0)
+        {
+            CLEAR_BIT(_hfdcan->Instance->CCCR, FDCAN_CCCR_INIT);
+            _health.recover_num++;
+            _health.backoff_ms = _health.backoff_ms * 2 > CAN_RECOVER_MAX_MS
+                                     ? CAN_RECOVER_MAX_MS
+                                     : _health.backoff_ms * 2;
+            _recover_tick = now + pdMS_TO_TICKS(_health.backoff_ms);
+        }
     }
+    else if (protocol.ErrorPassive)
+        _health.state = bus_passive;
+    else if (protocol.Warning)
+        _health.state = bus_warning;
+    else
+        _health.state = bus_ok;
 
-    // xSemaphoreGive(_registermtx);
+    if (bus_recovering != _health.state)
+        _health.backoff_ms = 0;
     return pyro::PYRO_OK;
-    // }
-    // return pyro::PYRO_ERROR;
 }
 
-pyro::status_t can_drv_t::register_rx_msg(can_msg_buffer_t *msg_buffer)
+const can_drv_t::health_t &can_drv_t::get_health(void)
+{
+    return _health;
+}
+
+pyro::status_t can_drv_t::register_rx_msg(can_msg_buffer_t *msg_buffer,
+                                          rx_route_t route)
 {
-    // if(xSemaphoreTake(_registermtx,portMAX_DELAY)==pdTRUE)
-    // {
-    uint32_t id = msg_buffer->get_id();
-    if (this->_registerlist.exist(id))
+    uint32_t id           = msg_buffer->get_id();
+    bool extended         = msg_buffer->is_extended();
+    pyro::status_t status = pyro::PYRO_OK;
+
+    // The rx isr reads these tables, keep it out while they change.
+    taskENTER_CRITICAL();
+    can_msg_buffer_t *head = find_rx_head(id, extended);
+    if (head)
     {
-        // xSemaphoreGive(_registermtx);
-        return pyro::PYRO_ERROR;
+        // Another subscriber of a registered id joins its chain and keeps
+        // the route of the first one, the filters stay as they are
+        can_msg_buffer_t *tail = head;
+        while (tail != msg_buffer && tail->_next)
+            tail = tail->_next;
+        if (tail == msg_buffer)
+            status = pyro::PYRO_ERROR;
+        else
+            tail->_next = msg_buffer;
+        taskEXIT_CRITICAL();
+        return status;
+    }
+    if (rx_route_buffer == route)
+    {
+        if (!extended && id >= STD_ID_NUM)
+            status = pyro::PYRO_PARAM_ERROR;
+        else if (_rx_buf_num >= CAN_RX_BUFFER_MAX_NUM ||
+                 _rx_buf_num >= _hfdcan->Init.RxBuffersNbr)
+            status = pyro::PYRO_NO_MEMORY;
+        else
+            _rx_buf_msgs[_rx_buf_num++] = msg_buffer;
+    }
+    else
+        status = _rx_table.add(id, extended, msg_buffer);
+    taskEXIT_CRITICAL();
+
+    if (pyro::PYRO_OK != status)
+        return status;
+    return update_filters();
+}
+
+// Rebuilds the acceptance filter lists from the registered ids so that
+// frames nobody listens to are dropped by the controller, not the isr.
+pyro::status_t can_drv_t::update_filters(void)
+{
+    static uint32_t ids[CAN_FILTER_PACK_MAX];
+    pyro::status_t status;
+    uint32_t std_first = 0;
+    uint32_t ext_first = 0;
+    uint8_t id_num;
+
+    // Shared scratch, and registrations from different tasks must not
+    // interleave their filter writes.
+    vTaskSuspendAll();
+    // Dedicated buffer elements come first, the first matching element wins
+    status = program_buffer_filters(std_first, ext_first);
+
+    id_num = _rx_table.std_ids(ids);
+    if (pyro::PYRO_OK == status)
+        status = program_filters(FDCAN_STANDARD_ID, ids, id_num, std_first,
+                                 _hfdcan->Init.StdFiltersNbr);
+
+    id_num = _rx_table.ext_ids(ids);
+    if (pyro::PYRO_OK == status)
+        status = program_filters(FDCAN_EXTENDED_ID, ids, id_num, ext_first,
+                                 _hfdcan->Init.ExtFiltersNbr);
+    (void)xTaskResumeAll();
+    return status;
+}
+
+pyro::status_t can_drv_t::program_buffer_filters(uint32_t &std_num,
+                                                 uint32_t &ext_num)
+{
+    FDCAN_FilterTypeDef fdcan_filter = {};
+    fdcan_filter.FilterConfig        = FDCAN_FILTER_TO_RXBUFFER;
+    fdcan_filter.FilterType          = FDCAN_FILTER_DUAL;
+    fdcan_filter.IsCalibrationMsg    = 0;
+
+    for (uint8_t i = 0; i < _rx_buf_num; i++)
+    {
+        bool extended = _rx_buf_msgs[i]->is_extended();
+        uint32_t &num = extended ? ext_num : std_num;
+        if (num >= (extended ? _hfdcan->Init.ExtFiltersNbr
+                             : _hfdcan->Init.StdFiltersNbr))
+            return pyro::PYRO_NO_MEMORY;
+
+        fdcan_filter.IdType        = extended ? FDCAN_EXTENDED_ID
+                                              : FDCAN_STANDARD_ID;
+        fdcan_filter.FilterIndex   = num++;
+        fdcan_filter.FilterID1     = _rx_buf_msgs[i]->get_id();
+        fdcan_filter.FilterID2     = 0;
+        fdcan_filter.RxBufferIndex = i;
+        if (HAL_OK != HAL_FDCAN_ConfigFilter(_hfdcan, &fdcan_filter))
+            return pyro::PYRO_ERROR;
+    }
+    return pyro::PYRO_OK;
+}
+
+pyro::status_t can_drv_t::program_filters(uint32_t id_type,
+                                          const uint32_t *ids, uint8_t id_num,
+                                          uint32_t first, uint32_t filter_nbr)
+{
+    static can_filter_elem_t elems[CAN_FILTER_PACK_MAX];
+    FDCAN_FilterTypeDef fdcan_filter;
+    uint32_t free_nbr = filter_nbr > first ? filter_nbr - first : 0;
+    uint8_t elem_max =
+        free_nbr < CAN_FILTER_PACK_MAX ? free_nbr : CAN_FILTER_PACK_MAX;
+    if (id_num && !elem_max)
+        return pyro::PYRO_NO_MEMORY;
+    uint8_t elem_num =
+        can_filter_pack(ids, id_num, FDCAN_STANDARD_ID == id_type ? 11 : 29,
+                        elems, elem_max, nullptr);
+
+    fdcan_filter.IdType = id_type;
+    for (uint32_t i = 0; i < free_nbr; i++)
+    {
+        fdcan_filter.FilterIndex = first + i;
+        if (i < elem_num)
+        {
+            fdcan_filter.FilterConfig = FDCAN_FILTER_TO_RXFIFO0;
+            fdcan_filter.FilterID1    = elems[i].id1;
+            fdcan_filter.FilterID2    = elems[i].id2;
+            switch (elems[i].type)
+            {
+                case can_filter_range:
+                    fdcan_filter.FilterType = FDCAN_STANDARD_ID == id_type
+                                                  ? FDCAN_FILTER_RANGE
+                                                  : FDCAN_FILTER_RANGE_NO_EIDM;
+                    break;
+                case can_filter_dual:
+                    fdcan_filter.FilterType = FDCAN_FILTER_DUAL;
+                    break;
+                default:
+                    fdcan_filter.FilterType = FDCAN_FILTER_MASK;
+                    break;
+            }
+        }
+        else
+        {
+            fdcan_filter.FilterConfig = FDCAN_FILTER_DISABLE;
+            fdcan_filter.FilterType   = FDCAN_FILTER_DUAL;
+            fdcan_filter.FilterID1    = 0;
+            fdcan_filter.FilterID2    = 0;
+        }
+        if (HAL_OK != HAL_FDCAN_ConfigFilter(_hfdcan, &fdcan_filter))
+            return pyro::PYRO_ERROR;
     }
-    this->_registerlist[id] = msg_buffer;
-    // xSemaphoreGive(_registermtx);
     return pyro::PYRO_OK;
-    // }
-    // return pyro::PYRO_ERROR;
 }
 
-pyro::status_t can_drv_t::handle_rx_msg(uint32_t id,
-                                        uint8_t *data) // mutex or not
+// First subscriber of an id on any route, nullptr if not registered
+can_msg_buffer_t *can_drv_t::find_rx_head(uint32_t id, bool extended)
+{
+    for (uint8_t i = 0; i < _rx_buf_num; i++)
+    {
+        if (_rx_buf_msgs[i]->get_id() == id &&
+            _rx_buf_msgs[i]->is_extended() == extended)
+            return _rx_buf_msgs[i];
+    }
+    return _rx_table.find(id, extended);
+}
+
+void can_drv_t::dispatch(can_msg_buffer_t *msg, const uint8_t *data,
+                         uint8_t len, uint64_t rx_us)
+{
+    for (; msg; msg = msg->_next)
+        msg->update_data(data, len, rx_us);
+}
+
+// Drains everything that is pending in the fifo, up to CAN_RX_BATCH_MAX
+// frames, so a burst of feedback frames costs one interrupt entry. Frames
+// left over by the cap are picked up on the next interrupt.
+// The payload is handed on while it is still in message RAM and the element
+// is only acknowledged afterwards, so it is copied once, straight into the
+// registered buffer or the deferred ring slot.
+pyro::status_t can_drv_t::handle_rx_fifo(uint32_t rx_fifo,
+                                         uint32_t rx_fifo_its)
+{
+    uint32_t start_cycles = pyro_time_cycles();
+
+    if (rx_fifo_its & FDCAN_IT_RX_FIFO0_FULL)
+        _rx_stats.fifo_full_num++;
+    if (rx_fifo_its & FDCAN_IT_RX_FIFO0_MESSAGE_LOST)
+        _rx_stats.fifo_lost_num++;
+
+    uint32_t batch = 0;
+    uint8_t room   = elmt_size_to_len(FDCAN_RX_FIFO0 == rx_fifo
+                                          ? _hfdcan->Init.RxFifo0ElmtSize
+                                          : _hfdcan->Init.RxFifo1ElmtSize);
+
+    while (batch < CAN_RX_BATCH_MAX)
+    {
+        uint32_t get_index;
+        const uint32_t *element = rx_fifo_element(rx_fifo, get_index);
+        if (nullptr == element)
+            break;
+        const uint8_t *data = parse_rx_element(element);
+        batch++;
+        account_rx_frame();
+        if (FDCAN_DATA_FRAME == _rx_header.RxFrameType)
+            rx_deliver(data, -1, room);
+        if (FDCAN_RX_FIFO0 == rx_fifo)
+            _hfdcan->Instance->RXF0A = get_index;
+        else
+            _hfdcan->Instance->RXF1A = get_index;
+    }
+
+    _rx_stats.irq_num++;
+    _rx_stats.frame_num += batch;
+    if (batch > _rx_stats.batch_max)
+        _rx_stats.batch_max = batch;
+    rx_isr_done(start_cycles);
+    return batch ? pyro::PYRO_OK : pyro::PYRO_NOT_FOUND;
+}
+
+// Oldest element of the fifo in message RAM, nullptr if the fifo is empty.
+// Same index rules as HAL_FDCAN_GetRxMessage, including overwrite mode.
+const uint32_t *can_drv_t::rx_fifo_element(uint32_t rx_fifo,
+                                           uint32_t &get_index)
+{
+    FDCAN_GlobalTypeDef *can = _hfdcan->Instance;
+    bool fifo0               = FDCAN_RX_FIFO0 == rx_fifo;
+    uint32_t rxfs            = fifo0 ? can->RXF0S : can->RXF1S;
+    uint32_t rxfc            = fifo0 ? can->RXF0C : can->RXF1C;
+    uint32_t start =
+        fifo0 ? _hfdcan->msgRam.RxFIFO0SA : _hfdcan->msgRam.RxFIFO1SA;
+    uint32_t words =
+        fifo0 ? _hfdcan->Init.RxFifo0ElmtSize : _hfdcan->Init.RxFifo1ElmtSize;
+
+    // Fill level, full flag, get index and overwrite mode sit at the same
+    // position in the fifo 0 and fifo 1 registers
+    if (0U == (rxfs & FDCAN_RXF0S_F0FL))
+        return nullptr;
+    get_index = (rxfs & FDCAN_RXF0S_F0GI) >> FDCAN_RXF0S_F0GI_Pos;
+    if ((rxfs & FDCAN_RXF0S_F0F) && (rxfc & FDCAN_RXF0C_F0OM))
+        get_index++;
+    return reinterpret_cast<const uint32_t *>(start + get_index * words * 4U);
+}
+
+const uint32_t *can_drv_t::rx_buffer_element(uint32_t index)
 {
-    // if(xSemaphoreTake(_registermtx,portMAX_DELAY)==pdTRUE)
-    // {
-    if (!this->_registerlist.exist(id))
+    return reinterpret_cast<const uint32_t *>(
+        _hfdcan->msgRam.RxBufferSA + index * _hfdcan->Init.RxBufferSize * 4U);
+}
+
+// Decodes the two header words into _rx_header, returns the payload, which
+// stays valid until the element is acknowledged
+const uint8_t *can_drv_t::parse_rx_element(const uint32_t *element)
+{
+    uint32_t r0 = element[0];
+    uint32_t r1 = element[1];
+
+    _rx_header.IdType     = r0 & FDCAN_EXTENDED_ID;
+    _rx_header.Identifier = FDCAN_STANDARD_ID == _rx_header.IdType
+                                ? (r0 >> 18) & 0x7FFU
+                                : r0 & 0x1FFFFFFFU;
+    _rx_header.RxFrameType         = r0 & FDCAN_REMOTE_FRAME;
+    _rx_header.ErrorStateIndicator = r0 & FDCAN_ESI_PASSIVE;
+    _rx_header.RxTimestamp         = r1 & 0xFFFFU;
+    _rx_header.DataLength          = (r1 >> 16) & 0xFU;
+    _rx_header.BitRateSwitch       = r1 & FDCAN_BRS_ON;
+    _rx_header.FDFormat            = r1 & FDCAN_FD_CAN;
+    _rx_header.FilterIndex         = (r1 >> 24) & 0x7FU;
+    _rx_header.IsFilterMatchingFrame = r1 >> 31;
+    return reinterpret_cast<const uint8_t *>(element + 2);
+}
+
+// Immediate mode copies the payload into the subscribers here. Deferred mode
+// copies it into a ring slot, or drops the frame if the ring is full. room
+// is the data size of the element read: an FD frame stored in a smaller
+// element keeps only its first room bytes, the dlc still counts all of them.
+void can_drv_t::rx_deliver(const uint8_t *data, int8_t buf_index,
+                           uint8_t room)
+{
+    uint8_t len   = dlc_to_len(_rx_header.DataLength);
+    bool extended = FDCAN_EXTENDED_ID == _rx_header.IdType;
+    if (len > room)
+    {
+        _rx_stats.trunc_num++;
+        len = room;
+    }
+    // Start of frame on the bus rather than the time the isr got to it, so
+    // frames from different buses line up on one clock
+    uint64_t rx_us =
+        _ts_en ? ts_to_us(_rx_header.RxTimestamp) : pyro_time_us();
+
+    if (rx_mode_deferred != _rx_mode)
+    {
+        if (buf_index < 0)
+            handle_rx_msg(_rx_header.Identifier, extended, data, len, rx_us);
+        else if (buf_index < _rx_buf_num)
+            dispatch(_rx_buf_msgs[buf_index], data, len, rx_us);
+        return;
+    }
+    rx_frame_t *slot = _rx_ring->claim();
+    if (nullptr == slot)
+    {
+        _rx_stats.ring_drop_num++;
+        return;
+    }
+    memcpy(slot->data, data, len);
+    slot->id        = _rx_header.Identifier;
+    slot->len       = len;
+    slot->extended  = extended;
+    slot->buf_index = buf_index;
+    slot->rx_us     = rx_us;
+    _rx_ring->commit();
+    _rx_pending = true;
+}
+
+// BRS buses leave the counter off, see init(), and have nothing to track
+void can_drv_t::time_sync(void)
+{
+    if (!_ts_en)
+        return;
+
+    UBaseType_t mask = portSET_INTERRUPT_MASK_FROM_ISR();
+    uint64_t now_us  = pyro_time_us();
+    uint16_t now     = HAL_FDCAN_GetTimestampCounter(_hfdcan);
+    portCLEAR_INTERRUPT_MASK_FROM_ISR(mask);
+
+    uint16_t ticks = static_cast<uint16_t>(now - _ts_last);
+    uint64_t us    = now_us - _ts_last_us;
+    bool first     = 0 == _ts_last_us;
+    _ts_last       = now;
+    _ts_last_us    = now_us;
+    if (first)
+        return;
+    // Ticks can not be unwrapped across a gap near one counter wrap
+    if (us * 1000 >= 0xF000ULL * _nom_bit_ns)
     {
-        // xSemaphoreGive(_registermtx);
+        _ts_win_us    = 0;
+        _ts_win_ticks = 0;
+        return;
+    }
+
+    _ts_win_us += us;
+    _ts_win_ticks += ticks;
+    if (_ts_win_us < CAN_TIME_SYNC_WINDOW_MS * 1000ULL || 0 == _ts_win_ticks)
+        return;
+
+    int64_t measured = static_cast<int64_t>((_ts_win_us * 1000) << 16) /
+                       _ts_win_ticks;
+    int64_t nominal  = static_cast<int64_t>(_nom_bit_ns) << 16;
+    int64_t error    = measured - nominal;
+    _ts_win_us       = 0;
+    _ts_win_ticks    = 0;
+    if (error > nominal / 100 || error < -nominal / 100)
+    {
+        _time_sync.reject_num++;
+        return;
+    }
+    int64_t scale = _time_sync.scale_q16;
+    scale += (measured - scale) / 4;
+    _time_sync.scale_q16 = static_cast<uint32_t>(scale);
+    _time_sync.sync_num++;
+}
+
+// Anchored to the counter and clock read now, so only the age of the event
+// is scaled and the rate error stays proportional to that age. Without a
+// usable counter the event is taken as happening now.
+uint64_t can_drv_t::ts_to_us(uint16_t ts)
+{
+    if (!_ts_en)
+        return pyro_time_us();
+
+    UBaseType_t mask = portSET_INTERRUPT_MASK_FROM_ISR();
+    uint64_t now_us  = pyro_time_us();
+    uint16_t now     = HAL_FDCAN_GetTimestampCounter(_hfdcan);
+    portCLEAR_INTERRUPT_MASK_FROM_ISR(mask);
+
+    uint16_t age_ticks = static_cast<uint16_t>(now - ts);
+    uint64_t age_ns =
+        (static_cast<uint64_t>(age_ticks) * _time_sync.scale_q16) >> 16;
+    return now_us - age_ns / 1000;
+}
+
+const can_drv_t::time_sync_t &can_drv_t::get_time_sync(void)
+{
+    return _time_sync;
+}
+
+void can_drv_t::rx_isr_done(uint32_t start_cycles)
+{
+#if CAN_RX_DEFERRED_EN
+    if (_rx_pending && can_rx_task_handle)
+    {
+        BaseType_t woken = pdFALSE;
+        xTaskNotifyFromISR(can_rx_task_handle, 1U << _bus, eSetBits, &woken);
+        portYIELD_FROM_ISR(woken);
+    }
+#endif
+    _rx_pending = false;
+
+    uint32_t cycles           = pyro_time_cycles() - start_cycles;
+    _rx_stats.isr_cycles_last = cycles;
+    if (cycles > _rx_stats.isr_cycles_max[_rx_mode])
+        _rx_stats.isr_cycles_max[_rx_mode] = cycles;
+}
+
+pyro::status_t can_drv_t::set_rx_mode(rx_mode_t mode)
+{
+    if (rx_mode_immediate == mode)
+    {
+        _rx_mode = mode;
+        return pyro::PYRO_OK;
+    }
+#if CAN_RX_DEFERRED_EN
+    if (_bus < 0)
+        return pyro::PYRO_PARAM_ERROR;
+
+    taskENTER_CRITICAL();
+    if (nullptr == can_rx_task_handle)
+        can_rx_task_handle = xTaskCreateStatic(
+            rx_task, "can_rx", CAN_RX_TASK_STACK_SIZE, nullptr,
+            CAN_RX_TASK_PRIORITY, can_rx_task_stack, &can_rx_task_tcb);
+    can_rx_deferred_drv[_bus] = this;
+    _rx_ring                  = &can_rx_ring_table[_bus];
+    _rx_mode                  = mode;
+    taskEXIT_CRITICAL();
+    return pyro::PYRO_OK;
+#else
+    return pyro::PYRO_PARAM_ERROR;
+#endif
+}
+
+void can_drv_t::rx_drain(void)
+{
+    rx_frame_t *slot;
+    while (nullptr != (slot = _rx_ring->front()))
+    {
+        if (slot->buf_index < 0)
+            handle_rx_msg(slot->id, slot->extended, slot->data, slot->len,
+                          slot->rx_us);
+        else if (slot->buf_index < _rx_buf_num)
+            dispatch(_rx_buf_msgs[slot->buf_index], slot->data, slot->len,
+                     slot->rx_us);
+        _rx_ring->release();
+    }
+}
+
+void can_drv_t::rx_task(void *arg)
+{
+#if CAN_RX_DEFERRED_EN
+    while (true)
+    {
+        uint32_t buses = 0;
+        xTaskNotifyWait(0, UINT32_MAX, &buses, portMAX_DELAY);
+        for (uint8_t bus = 0; bus < CAN_BUS_NUM; bus++)
+        {
+            if ((buses & (1U << bus)) && can_rx_deferred_drv[bus])
+                can_rx_deferred_drv[bus]->rx_drain();
+        }
+    }
+#endif
+}
+
+uint8_t can_drv_t::dlc_to_len(uint32_t dlc)
+{
+    static const uint8_t len[16] = {0,  1,  2,  3,  4,  5,  6,  7,
+                                    8, 12, 16, 20, 24, 32, 48, 64};
+    return len[dlc & 0xF];
+}
+
+// Smallest dlc that holds len bytes
+uint32_t can_drv_t::len_to_dlc(uint8_t len)
+{
+    if (len <= 8)
+        return len;
+    if (len <= 24)
+        return 9 + (len - 9) / 4;
+    if (len <= 32)
+        return FDCAN_DLC_BYTES_32;
+    if (len <= 48)
+        return FDCAN_DLC_BYTES_48;
+    return FDCAN_DLC_BYTES_64;
+}
+
+uint8_t can_drv_t::elmt_size_to_len(uint32_t elmt_size)
+{
+    switch (elmt_size)
+    {
+        case FDCAN_DATA_BYTES_12:
+            return 12;
+        case FDCAN_DATA_BYTES_16:
+            return 16;
+        case FDCAN_DATA_BYTES_20:
+            return 20;
+        case FDCAN_DATA_BYTES_24:
+            return 24;
+        case FDCAN_DATA_BYTES_32:
+            return 32;
+        case FDCAN_DATA_BYTES_48:
+            return 48;
+        case FDCAN_DATA_BYTES_64:
+            return 64;
+        default:
+            return 8;
+    }
+}
+
+// Walks the new data flags, a buffer's flag is cleared once it is delivered
+pyro::status_t can_drv_t::handle_rx_buffers(void)
+{
+    uint32_t start_cycles = pyro_time_cycles();
+    uint32_t new_data     = _hfdcan->Instance->NDAT1;
+
+    if (!new_data)
         return pyro::PYRO_NOT_FOUND;
+    uint8_t room = elmt_size_to_len(_hfdcan->Init.RxBufferSize);
+    while (new_data)
+    {
+        uint32_t index = __builtin_ctz(new_data);
+        new_data &= new_data - 1;
+        const uint8_t *data = parse_rx_element(rx_buffer_element(index));
+        _rx_stats.buffer_frame_num++;
+        account_rx_frame();
+        rx_deliver(data, index, room);
+        _hfdcan->Instance->NDAT1 = 1U << index;
     }
-    can_msg_buffer_t *msg = this->_registerlist[id];
-    msg->update_data(data);
-    // xSemaphoreGive(_registermtx);
+    rx_isr_done(start_cycles);
     return pyro::PYRO_OK;
-    // }
-    // return pyro::PYRO_ERROR;
 }
 
-can_hub_t::can_hub_t() : _can_drv_map()
-{ // Log
-    this->_can_drv_map.clear();
+const can_drv_t::rx_stats_t &can_drv_t::get_rx_stats(void)
+{
+    return _rx_stats;
 }
 
-can_hub_t *can_hub_t::_instancePtr = nullptr;
-can_hub_t *_instancePtr_copy       = nullptr;
+pyro::status_t can_drv_t::handle_rx_msg(uint32_t id, bool extended,
+                                        const uint8_t *data, uint8_t len,
+                                        uint64_t rx_us)
+{
+    can_msg_buffer_t *msg =
+        extended ? _rx_table.find_ext(id) : _rx_table.find_std(id);
+
+    if (nullptr == msg)
+        return pyro::PYRO_NOT_FOUND;
+    dispatch(msg, data, len, rx_us);
+    return pyro::PYRO_OK;
+}
+
+can_hub_t can_hub_t::_instance;
+
 can_hub_t *can_hub_t::get_instance(void)
 {
-    if (_instancePtr == nullptr) // Mutex
+    return &_instance;
+}
+
+int8_t can_hub_t::bus_index(const FDCAN_HandleTypeDef *hfdcan)
+{
+    for (uint8_t i = 0; i < CAN_BUS_NUM; i++)
+    {
+        if (can_bus_table[i].hfdcan == hfdcan)
+            return i;
+    }
+    return -1;
+}
+
+const can_hub_t::bus_desc_t *can_hub_t::get_bus_desc(uint8_t index)
+{
+    return index < CAN_BUS_NUM ? &can_bus_table[index] : nullptr;
+}
+
+pyro::status_t can_hub_t::hub_start_all(void)
+{
+    pyro::status_t ret = pyro::PYRO_OK;
+    for (uint8_t i = 0; i < CAN_BUS_NUM; i++)
+    {
+        if (pyro::PYRO_OK != can_drv_table[i].init() ||
+            pyro::PYRO_OK != can_drv_table[i].start())
+            ret = pyro::PYRO_ERROR;
+    }
+    if (pyro::PYRO_OK != hub_start_monitor())
+        ret = pyro::PYRO_ERROR;
+    return ret;
+}
+
+pyro::status_t can_hub_t::hub_start_monitor(void)
+{
+    taskENTER_CRITICAL();
+    if (nullptr == can_monitor_task_handle)
+        can_monitor_task_handle = xTaskCreateStatic(
+            monitor_task, "can_mon", CAN_MONITOR_STACK_SIZE, this,
+            CAN_MONITOR_PRIORITY, can_monitor_stack, &can_monitor_tcb);
+    taskEXIT_CRITICAL();
+    return can_monitor_task_handle ? pyro::PYRO_OK : pyro::PYRO_ERROR;
+}
+
+// Owns the periodic bus work, so bus-off recovery and the timestamp rate
+// tracking do not depend on the optional tx scheduler running
+void can_hub_t::monitor_task(void *arg)
+{
+    can_hub_t *self    = static_cast<can_hub_t *>(arg);
+    TickType_t wake    = xTaskGetTickCount();
+    uint32_t sync_ms   = 0;
+    uint32_t health_ms = 0;
+    while (true)
     {
-        _instancePtr      = new can_hub_t();
-        _instancePtr_copy = _instancePtr;
+        vTaskDelayUntil(&wake, pdMS_TO_TICKS(CAN_MONITOR_PERIOD_MS));
+        self->hub_tx_poll();
+
+        sync_ms += CAN_MONITOR_PERIOD_MS;
+        if (sync_ms >= CAN_TIME_SYNC_MS)
+        {
+            sync_ms = 0;
+            self->hub_time_sync();
+        }
+
+        health_ms += CAN_MONITOR_PERIOD_MS;
+        if (health_ms >= CAN_HEALTH_POLL_MS)
+        {
+            health_ms = 0;
+            self->hub_health_poll();
+        }
     }
-    return _instancePtr;
 }
+
+// Only the table's own driver can be registered for a bus
 pyro::status_t can_hub_t::hub_register_can_obj(FDCAN_HandleTypeDef *hfdcan,
                                                can_drv_t *can_drv)
 {
-    if (this->_can_drv_map.exist(hfdcan))
-        return PYRO_ERROR;
-    this->_can_drv_map[hfdcan] = can_drv;
+    int8_t bus = bus_index(hfdcan);
+    if (bus < 0 || can_drv != &can_drv_table[bus])
+        return pyro::PYRO_PARAM_ERROR;
+    taskENTER_CRITICAL();
+    _active_mask |= 1U << bus;
+    taskEXIT_CRITICAL();
     return pyro::PYRO_OK;
 }
 
 status_t can_hub_t::hub_unregister_can_obj(FDCAN_HandleTypeDef *hfdcan)
 {
-    if (!this->_can_drv_map.exist(hfdcan))
-        return pyro::PYRO_ERROR;
-    this->_can_drv_map.erase(hfdcan);
+    int8_t bus = bus_index(hfdcan);
+    if (bus < 0)
+        return pyro::PYRO_PARAM_ERROR;
+    taskENTER_CRITICAL();
+    _active_mask &= ~(1U << bus);
+    taskEXIT_CRITICAL();
     return pyro::PYRO_OK;
 }
 
 can_drv_t *can_hub_t::hub_get_can_obj(which_can which_can)
 {
-    FDCAN_HandleTypeDef *hfdcan = nullptr;
-    switch (which_can)
-    {
-        case can1:
-            hfdcan = &hfdcan1;
-            break;
-        case can2:
-            hfdcan = &hfdcan2;
-            break;
-        case can3:
-            hfdcan = &hfdcan3;
-            break;
-        default:
-            return nullptr;
-    }
-    can_drv_t *can_drv = this->_can_drv_map[hfdcan];
-    return can_drv;
+    if (which_can >= CAN_BUS_NUM)
+        return nullptr;
+    return &can_drv_table[which_can];
+}
+
+can_drv_t *can_hub_t::active_drv(FDCAN_HandleTypeDef *hfdcan)
+{
+    int8_t bus = bus_index(hfdcan);
+    if (bus < 0 || !(_active_mask & (1U << bus)))
+        return nullptr;
+    return &can_drv_table[bus];
 }
-//    pyro::status_t hub_unregister_can_client(which_can which_can,uint32_t id);
 
-pyro::status_t can_hub_t::hub_handle_callback(FDCAN_HandleTypeDef *hfdcan,
-                                              uint32_t identifier,
-                                              uint8_t *data)
+pyro::status_t can_hub_t::hub_handle_rx_fifo(FDCAN_HandleTypeDef *hfdcan,
+                                             uint32_t rx_fifo,
+                                             uint32_t rx_fifo_its)
 {
-    if (!this->_can_drv_map.exist(hfdcan))
+    can_drv_t *drv = active_drv(hfdcan);
+    if (nullptr == drv)
         return pyro::PYRO_ERROR;
-    // return this->_can_drv_map[hfdcan]->hub_handle_callback(hfdcan, data);
-    return this->_can_drv_map[hfdcan]->handle_rx_msg(identifier, data);
+    return drv->handle_rx_fifo(rx_fifo, rx_fifo_its);
 }
 
-}; // namespace pyro
+pyro::status_t can_hub_t::hub_handle_rx_buffers(FDCAN_HandleTypeDef *hfdcan)
+{
+    can_drv_t *drv = active_drv(hfdcan);
+    if (nullptr == drv)
+        return pyro::PYRO_ERROR;
+    return drv->handle_rx_buffers();
+}
 
-void can_global_handle(FDCAN_HandleTypeDef *hfdcan, uint32_t identifier,
-                       uint8_t *data)
+pyro::status_t can_hub_t::hub_handle_tx_complete(FDCAN_HandleTypeDef *hfdcan,
+                                                 uint32_t buffer_indexes)
 {
-    pyro::can_hub_t::get_instance()->hub_handle_callback(hfdcan, identifier,
-                                                         data);
+    can_drv_t *drv = active_drv(hfdcan);
+    if (nullptr == drv)
+        return pyro::PYRO_ERROR;
+    drv->handle_tx_complete(buffer_indexes);
+    return pyro::PYRO_OK;
 }
 
-FDCAN_RxHeaderTypeDef rx_header;
-uint32_t a;
-extern "C" void HAL_FDCAN_RxFifo0Callback(FDCAN_HandleTypeDef *hfdcan,
-                                          uint32_t RxFifo0ITs)
+pyro::status_t can_hub_t::hub_handle_tx_event(FDCAN_HandleTypeDef *hfdcan,
+                                              uint32_t tx_event_its)
+{
+    can_drv_t *drv = active_drv(hfdcan);
+    if (nullptr == drv)
+        return pyro::PYRO_ERROR;
+    drv->handle_tx_event(tx_event_its);
+    return pyro::PYRO_OK;
+}
+
+pyro::status_t
+can_hub_t::hub_handle_error_status(FDCAN_HandleTypeDef *hfdcan,
+                                   uint32_t error_status_its)
 {
+    can_drv_t *drv = active_drv(hfdcan);
+    if (nullptr == drv)
+        return pyro::PYRO_ERROR;
+    drv->handle_error_status(error_status_its);
+    return pyro::PYRO_OK;
+}
 
-    uint8_t data[8];
-    if (HAL_OK !=
-        HAL_FDCAN_GetRxMessage(hfdcan, FDCAN_RX_FIFO0, &rx_header, data))
+void can_hub_t::hub_time_sync(void)
+{
+    for (uint8_t i = 0; i < CAN_BUS_NUM; i++)
     {
-        return;
+        if (_active_mask & (1U << i))
+            can_drv_table[i].time_sync();
     }
-    if (FDCAN_FRAME_CLASSIC == rx_header.RxFrameType &&
-        FDCAN_STANDARD_ID == rx_header.IdType)
+}
+
+void can_hub_t::hub_health_poll(void)
+{
+    for (uint8_t i = 0; i < CAN_BUS_NUM; i++)
     {
-        if (hfdcan == &hfdcan1)
-            a++;
-        else if (hfdcan == &hfdcan2)
-            a--;
-        else if (hfdcan == &hfdcan3)
-            a;
+        if (_active_mask & (1U << i))
+            can_drv_table[i].health_poll();
+    }
+}
 
-        can_global_handle(hfdcan, rx_header.Identifier, data);
+void can_hub_t::hub_tx_poll(void)
+{
+    for (uint8_t i = 0; i < CAN_BUS_NUM; i++)
+    {
+        if (_active_mask & (1U << i))
+            can_drv_table[i].tx_poll();
     }
-}
\ No newline at end of file
+}
+
+}; // namespace pyro
+
+extern "C" void HAL_FDCAN_RxFifo0Callback(FDCAN_HandleTypeDef *hfdcan,
+                                          uint32_t RxFifo0ITs)
+{
+    pyro::can_hub_t::get_instance()->hub_handle_rx_fifo(hfdcan, FDCAN_RX_FIFO0,
+                                                        RxFifo0ITs);
+}
+
+extern "C" void
+HAL_FDCAN_RxBufferNewMessageCallback(FDCAN_HandleTypeDef *hfdcan)
+{
+    pyro::can_hub_t::get_instance()->hub_handle_rx_buffers(hfdcan);
+}
+
+extern "C" void HAL_FDCAN_TxBufferCompleteCallback(FDCAN_HandleTypeDef *hfdcan,
+                                                   uint32_t BufferIndexes)
+{
+    pyro::can_hub_t::get_instance()->hub_handle_tx_complete(hfdcan,
+                                                            BufferIndexes);
+}
+
+extern "C" void HAL_FDCAN_TxEventFifoCallback(FDCAN_HandleTypeDef *hfdcan,
+                                              uint32_t TxEventFifoITs)
+{
+    pyro::can_hub_t::get_instance()->hub_handle_tx_event(hfdcan,
+                                                         TxEventFifoITs);
+}
+
+extern "C" void HAL_FDCAN_ErrorStatusCallback(FDCAN_HandleTypeDef *hfdcan,
+                                              uint32_t ErrorStatusITs)
+{
+    pyro::can_hub_t::get_instance()->hub_handle_error_status(hfdcan,
+                                                             ErrorStatusITs);
+}
@@ -2,57 +2,487 @@
 #define CAN_DRV_H
 
 #include "fdcan.h"
+#include "pyro_core_config.h"
 #include "pyro_core_def.h"
 
 #include <array>
+#include <atomic>
 #include <cmsis_os.h>
 
-#include "map.h"
+#include "mpmc_ring.h"
+#include "pyro_can_rx_table.h"
+#include "spsc_ring.h"
+#include "pyro_seqlock.h"
+#include "pyro_time_hist.h"
 
 namespace pyro
 {
+class can_msg_buffer_t;
+class can_history_t;
+
+// Wakes one task when every buffer of the group has received a new frame.
+// The rx path sets the buffer's bit in the task notification value, so the
+// waiting task must not use its notification value for anything else.
+class can_notify_group_t
+{
+  public:
+    static constexpr uint8_t MAX_NUM = 32;
+
+    can_notify_group_t();
+    ~can_notify_group_t();
+
+    // Wakes the calling task from now on, call from the task that waits
+    status_t bind_current_task();
+    status_t add(can_msg_buffer_t *msg);
+    // PYRO_OK once all buffers reported since the last successful wait,
+    // PYRO_TIMEOUT otherwise. received returns the bits seen so far.
+    status_t wait_all(TickType_t timeout, uint32_t *received = nullptr);
+    void notify(uint32_t bit);
+
+  private:
+    TaskHandle_t _task;
+    uint32_t _all_mask;
+    uint32_t _received;
+    uint8_t _num;
+};
+
 class can_msg_buffer_t
 {
   public:
-    explicit can_msg_buffer_t(uint32_t id);
+    // Data and receive time are published together, so a reader never sees
+    // the payload of one frame with the timestamp of another
+    typedef struct frame_t
+    {
+        std::array<uint8_t, CAN_MAX_DATA_LEN> data;
+        uint8_t len;
+        TickType_t timestamp;
+        uint64_t timestamp_us;
+    } frame_t;
+
+    explicit can_msg_buffer_t(uint32_t id, bool extended = false);
     ~can_msg_buffer_t();
 
     uint32_t get_id();
+    bool is_extended();
     bool is_fresh();
     void mark_read();
-    void update_data(const uint8_t *data);
+    // Set by can_notify_group_t::add, one group per buffer
+    void set_notify(can_notify_group_t *group, uint32_t bit);
+    // Optional, every frame written to this buffer is also kept there
+    void attach_history(can_history_t *history);
+    can_history_t *get_history();
+    // rx_us is the receive time if the frame was taken earlier, 0 for now
+    void update_data(const uint8_t *data, uint8_t len = 8, uint64_t rx_us = 0);
+    // First 8 bytes, for classic frames
     bool get_data(std::array<uint8_t, 8> &data);
+    // len is the capacity of data on entry and the frame length on return
+    bool get_data(uint8_t *data, uint8_t &len);
+    bool get_frame(frame_t &frame);
+    // Calls fn(const frame_t &) on the latched frame instead of copying it
+    // out. fn runs again if the rx path wrote meanwhile, so it should decode
+    // into locals and the caller commits them once view returns true.
+    template <typename F> bool view(F &&fn)
+    {
+        uint64_t timestamp_us = 0;
+        if (!_frame.read_with([&](const frame_t &frame) {
+                timestamp_us = frame.timestamp_us;
+                fn(frame);
+            }))
+            return false;
+        record_age(timestamp_us);
+        return true;
+    }
     TickType_t get_last_update_time();
+    uint64_t get_last_update_us();
+    uint32_t get_age_us();
+#if CAN_RX_LATENCY_HIST_EN
+    // Time between two frames of this id, recorded in the rx interrupt
+    const time_hist_t &get_interval_hist();
+    // Age of the frame when a reader takes it with get_data / get_frame
+    const time_hist_t &get_age_hist();
+    void reset_hist();
+#endif
 
   private:
+    friend class can_drv_t;
+
+    void record_age(uint64_t timestamp_us);
+
     uint32_t _id;
-    std::array<uint8_t, 8> _buffer;
+    bool _extended;
+    seqlock_t<frame_t> _frame;
     volatile bool _is_fresh;
-    TickType_t _last_update_time;
+    can_notify_group_t *_notify_group;
+    uint32_t _notify_bit;
+    can_history_t *_history;
+    // Further subscribers of the same id, walked by the rx path
+    can_msg_buffer_t *_next;
+#if CAN_RX_LATENCY_HIST_EN
+    time_hist_t _interval_hist;
+    time_hist_t _age_hist;
+#endif
     SemaphoreHandle_t _mtx;
 };
 
+// Last N frames of one id. The rx path is the only writer; every entry
+// carries the absolute write position, so a reader can tell a valid entry
+// from one that was overwritten by the next lap or is being written.
+class can_history_t
+{
+  public:
+    using frame_t = can_msg_buffer_t::frame_t;
+
+    typedef struct entry_t
+    {
+        std::atomic<uint32_t> seq; // 2 * pos + 2 once written, odd while busy
+        frame_t frame;
+    } entry_t;
+
+    can_history_t(entry_t *entries, uint16_t depth);
+
+    void push(const frame_t &frame);
+    // back = 0 is the newest frame. False if not written yet or overwritten.
+    bool read(uint16_t back, frame_t &frame) const;
+    // Newest first, returns how many consecutive frames were valid
+    uint16_t read_latest(frame_t *frames, uint16_t num) const;
+    uint32_t get_count() const;
+    uint16_t get_depth() const;
+
+  private:
+    entry_t *_entries;
+    uint16_t _depth;
+    std::atomic<uint32_t> _count;
+};
+
+template <uint16_t N> class can_history_buf_t : public can_history_t
+{
+  public:
+    can_history_buf_t() : can_history_t(_storage.data(), N)
+    {
+    }
+
+  private:
+    std::array<entry_t, N> _storage;
+};
+
 class can_drv_t
 {
-    const uint8_t MAX_ID_REGIST_NUM = 32;
-    using can_id_regist_t           = uint16_t;
+    using rx_table_t                     = can_rx_table_t<can_msg_buffer_t>;
+    static constexpr uint16_t STD_ID_NUM = rx_table_t::STD_ID_NUM;
+
+    static uint8_t dlc_to_len(uint32_t dlc);
+    static uint32_t len_to_dlc(uint8_t len);
+    static uint8_t elmt_size_to_len(uint32_t elmt_size);
 
   public:
+    // Motor commands go high, telemetry and debug traffic low. The high
+    // queue is always drained into the hardware fifo first.
+    enum tx_prio_t
+    {
+        tx_prio_high,
+        tx_prio_low,
+        tx_prio_num
+    };
+
+    enum tx_flag_t
+    {
+        tx_flag_fd      = 0x01, // FD format, needs an FD bus
+        tx_flag_brs     = 0x02, // switch to the data bit rate, needs FD_BRS
+        tx_flag_no_gate = 0x04, // skips the tx policy, for state changes
+    };
+
+    typedef struct tx_frame_t
+    {
+        uint32_t id;
+        uint8_t len;
+        uint8_t flags;
+        uint32_t enqueue_us; // low 32 bits of pyro_time_us() in send_msg
+        uint8_t data[CAN_MAX_DATA_LEN];
+    } tx_frame_t;
+
+    using tx_ring_t = mpmc_ring_t<tx_frame_t, CAN_TX_QUEUE_LEN>;
+
+    typedef struct tx_stats_t
+    {
+        uint32_t sent_num;
+        uint32_t overflow_num[tx_prio_num]; // rejected, software queue full
+        uint32_t drop_num;                  // dequeued but refused by HAL
+        uint32_t queue_max;                 // software queue high water mark
+        uint32_t unchanged_num; // held back by a tx policy, same payload
+        uint32_t rate_num;      // delayed by a tx policy, sent too soon
+        uint32_t merge_num;     // delayed frame replaced by a newer one
+    } tx_stats_t;
+
+    typedef struct tx_gate_stats_t
+    {
+        uint32_t sent_num;
+        uint32_t unchanged_num;
+        uint32_t rate_num;
+        uint32_t merge_num;
+    } tx_gate_stats_t;
+
+    // Matched from the tx event fifo by message marker. Queueing is send_msg
+    // until the frame is written to the hardware fifo, arbitration is from
+    // there until its start of frame on the bus. On BRS buses the start of
+    // frame is estimated from the tx event isr time, see init().
+    typedef struct tx_latency_t
+    {
+        uint32_t event_num;
+        uint32_t unmatched_num; // marker not pending, an event was lost
+        uint32_t lost_num;      // tx event fifo overflowed
+        uint32_t queue_max_us;
+        uint32_t arb_max_us;
+        time_hist_t queue_hist;
+        time_hist_t arb_hist;
+    } tx_latency_t;
+
+    // Frames per interrupt is frame_num / irq_num
+    typedef struct rx_stats_t
+    {
+        uint32_t irq_num;
+        uint32_t frame_num;
+        uint32_t batch_max;
+        uint32_t fifo_full_num;    // rx fifo0 full interrupts
+        uint32_t fifo_lost_num;    // rx fifo0 message lost interrupts
+        uint32_t buffer_frame_num; // frames read from dedicated rx buffers
+        uint32_t ring_drop_num;    // deferred mode, dispatcher ring full
+        uint32_t trunc_num;        // dlc beyond the rx element, cut to fit
+        uint32_t isr_cycles_last;  // DWT cycles of the last rx interrupt
+        uint32_t isr_cycles_max[2]; // worst rx interrupt per rx_mode_t
+    } rx_stats_t;
+
+    // Immediate mode looks the id up and delivers inside the rx interrupt.
+    // Deferred mode only copies the frame into a ring, a dispatcher task
+    // shared by all buses does the lookup and delivery, which keeps the
+    // interrupt short for the UART / DMA irqs at the same priority.
+    enum rx_mode_t
+    {
+        rx_mode_immediate,
+        rx_mode_deferred
+    };
+
+    typedef struct rx_frame_t
+    {
+        uint32_t id;
+        uint8_t len;
+        bool extended;
+        int8_t buf_index; // dedicated rx buffer, -1 for fifo frames
+        uint64_t rx_us;
+        uint8_t data[CAN_MAX_DATA_LEN];
+    } rx_frame_t;
+
+    using rx_ring_t = spsc_ring_t<rx_frame_t, CAN_RX_RING_LEN>;
+
+    // fifo0 is shared by every id behind packed filters. A dedicated buffer
+    // takes one filter element and one rx buffer element, so other ids can
+    // not push its frame out. While the buffer holds an unread frame its
+    // filter does not match: the buffer keeps the oldest unread frame, and
+    // newer frames for the id are rejected or, if a packed fifo0 filter
+    // happens to cover the id, dropped from fifo0. Read it at least as fast
+    // as the id is sent.
+    enum rx_route_t
+    {
+        rx_route_fifo0,
+        rx_route_buffer
+    };
+
+    enum bus_state_t
+    {
+        bus_ok,
+        bus_warning,    // a counter is above 96
+        bus_passive,    // a counter is above 127
+        bus_recovering  // bus-off, waiting to restart the controller
+    };
+
+    // Rates and load cover the last health_poll window
+    typedef struct health_t
+    {
+        bus_state_t state;
+        uint32_t rx_fps;
+        uint32_t tx_fps;
+        // Frames this node sends and accepts, worst case stuffing. Traffic
+        // rejected by the filters is not seen and not counted.
+        uint16_t load_permille;
+        uint8_t tec;
+        uint8_t rec;
+        uint32_t warning_num;
+        uint32_t passive_num;
+        uint32_t bus_off_num;
+        uint32_t recover_num; // restarts attempted
+        uint32_t backoff_ms;  // delay before the next restart
+        uint32_t fifo_lost_num;
+    } health_t;
+
+    // Rate of the timestamp counter against the pyro_time_us() clock, stays
+    // at nominal with no syncs on BRS buses
+    typedef struct time_sync_t
+    {
+        uint32_t scale_q16;  // ns per counter tick, 16 fractional bits
+        uint32_t sync_num;   // windows measured
+        uint32_t reject_num; // windows off nominal by more than 1 %
+    } time_sync_t;
+
+    // Worst case length of a data frame in bits, stuff bits and intermission
+    // included. data_bits is the part sent at the data bit rate if BRS is on.
+    static uint32_t frame_bits(uint8_t len, bool extended, bool fd,
+                               uint32_t *data_bits = nullptr);
+
     explicit can_drv_t(FDCAN_HandleTypeDef *hfdcan);
     ~can_drv_t();
 
     status_t init();
+    // Before start()
+    status_t set_rx_mode(rx_mode_t mode);
     status_t start();
-    status_t send_msg(uint32_t id, uint8_t *data);
-    status_t register_rx_msg(can_msg_buffer_t *msg_buffer);
-    status_t handle_rx_msg(uint32_t id, uint8_t *data);
+    status_t send_msg(uint32_t id, uint8_t *data,
+                      tx_prio_t prio = tx_prio_high);
+    status_t send_msg(uint32_t id, const uint8_t *data, uint8_t len,
+                      uint8_t flags, tx_prio_t prio = tx_prio_high);
+    status_t register_rx_msg(can_msg_buffer_t *msg_buffer,
+                             rx_route_t route = rx_route_fifo0);
+    status_t handle_rx_fifo(uint32_t rx_fifo, uint32_t rx_fifo_its = 0);
+    status_t handle_rx_buffers();
+    status_t handle_rx_msg(uint32_t id, bool extended, const uint8_t *data,
+                           uint8_t len = 8, uint64_t rx_us = 0);
+    const rx_stats_t &get_rx_stats();
+    void handle_tx_complete(uint32_t buffer_indexes = 0);
+    const tx_stats_t &get_tx_stats();
+    // A frame identical to the last one sent on id is held back until
+    // keepalive_ms has passed; 0 sends it anyway, for ids where every frame
+    // is answered, like DM motor commands. A frame less than
+    // min_interval_us after the last one (0 no limit) is kept and sent once
+    // the interval is up, a newer frame for the id replaces it. send_msg
+    // returns PYRO_OK for both; tx_flag_no_gate frames skip the policy and
+    // cancel a delayed frame.
+    status_t set_tx_policy(uint32_t id, uint16_t keepalive_ms,
+                           uint32_t min_interval_us);
+    status_t get_tx_gate_stats(uint32_t id, tx_gate_stats_t &stats);
+    // Sends delayed frames that are due. The tx paths call it as well, the
+    // hub monitor task covers a quiet bus.
+    void tx_poll();
+    // Needs CAN_TX_EVENT_EN and TxEventsNbr > 0 for the bus in CubeMX
+    void handle_tx_event(uint32_t tx_event_its);
+    const tx_latency_t &get_tx_latency();
+    void reset_tx_latency();
+    uint64_t get_last_tx_complete_us();
+    void handle_error_status(uint32_t error_status_its);
+    // Called every CAN_HEALTH_POLL_MS by the hub monitor task: closes the
+    // rate window, reads the error counters and restarts the controller
+    // after bus-off with backoff
+    status_t health_poll();
+    const health_t &get_health();
+    // Called every CAN_TIME_SYNC_MS by the hub monitor task, tracks the
+    // counter rate
+    void time_sync();
+    // Timestamp counter value of a recent event (less than one counter wrap
+    // ago) on the common pyro_time_us() clock. BRS buses do not run the
+    // counter; time_sync() skips them and this returns the current time.
+    uint64_t ts_to_us(uint16_t ts);
+    const time_sync_t &get_time_sync();
 
   private:
+    typedef struct tx_gate_t
+    {
+        uint32_t id;
+        uint16_t keepalive_ms;
+        uint32_t min_interval_us;
+        uint32_t last_us;
+        bool sent; // len and data hold the last frame sent
+        uint8_t len;
+        uint8_t data[CAN_MAX_DATA_LEN];
+        bool held; // held_frame waits for min_interval_us
+        tx_prio_t held_prio;
+        tx_frame_t held_frame;
+        tx_gate_stats_t stats;
+    } tx_gate_t;
+
+    can_msg_buffer_t *find_rx_head(uint32_t id, bool extended);
+    static void dispatch(can_msg_buffer_t *msg, const uint8_t *data,
+                         uint8_t len, uint64_t rx_us = 0);
+    const uint32_t *rx_fifo_element(uint32_t rx_fifo, uint32_t &get_index);
+    const uint32_t *rx_buffer_element(uint32_t index);
+    const uint8_t *parse_rx_element(const uint32_t *element);
+    void rx_deliver(const uint8_t *data, int8_t buf_index, uint8_t room);
+    void rx_isr_done(uint32_t start_cycles);
+    void rx_drain();
+    static void rx_task(void *arg);
+    status_t update_filters();
+    status_t program_buffer_filters(uint32_t &std_num, uint32_t &ext_num);
+    status_t program_filters(uint32_t id_type, const uint32_t *ids,
+                             uint8_t id_num, uint32_t first,
+                             uint32_t filter_nbr);
+    tx_gate_t *find_tx_gate(uint32_t id);
+    status_t tx_gate_admit(tx_gate_t *gate, const tx_frame_t &frame,
+                           tx_prio_t prio);
+    void tx_gate_bypass(tx_gate_t *gate);
+    void tx_gate_revoke(tx_gate_t *gate);
+    void tx_gate_release();
+    void tx_pump();
+    HAL_StatusTypeDef tx_write(const tx_frame_t &frame);
+    uint32_t frame_ns(uint8_t len, bool extended, bool fd, bool brs);
+    void account_rx_frame();
+
     FDCAN_HandleTypeDef *_hfdcan;
-    map_t<uint32_t, can_msg_buffer_t *> _registerlist;
-    SemaphoreHandle_t _registermtx;
+    // fifo routed ids, first subscriber of each
+    rx_table_t _rx_table;
+    // rx buffer index -> message, filled in registration order
+    std::array<can_msg_buffer_t *, CAN_RX_BUFFER_MAX_NUM> _rx_buf_msgs;
+    uint8_t _rx_buf_num;
+
+    FDCAN_RxHeaderTypeDef _rx_header;
+    rx_stats_t _rx_stats;
+    int8_t _bus;
+    rx_mode_t _rx_mode;
+    rx_ring_t *_rx_ring;
+    bool _rx_pending;
+
+    // One ring per priority, static storage owned by the bus index
+    tx_ring_t *_tx_ring;
+    tx_stats_t _tx_stats;
+
+    std::array<tx_gate_t, CAN_TX_GATE_NUM> _tx_gates;
+    uint8_t _tx_gate_num;
+    uint64_t _last_tx_complete_us;
+
+    // Frame written to the hardware, waiting for its tx event
+    typedef struct tx_mark_t
+    {
+        uint32_t enqueue_us;
+        uint32_t write_us;
+        uint16_t write_ts; // timestamp counter, in nominal bit times
+        uint32_t frame_ns; // bus time of the frame
+        uint8_t marker;
+        bool pending;
+    } tx_mark_t;
+
+    bool _tx_event_en;
+    uint8_t _tx_marker;
+    // Indexed by marker, at most 32 frames are in the hardware at once
+    std::array<tx_mark_t, 32> _tx_marks;
+    tx_latency_t _tx_latency;
+
+    health_t _health;
+    uint32_t _nom_bit_ns;
+    uint32_t _data_bit_ns;
+    // Accumulated by the isrs, taken and cleared by health_poll
+    uint32_t _rx_frame_acc;
+    uint32_t _tx_frame_acc;
+    uint32_t _busy_ns_acc;
+    std::array<uint32_t, 32> _tx_buf_ns; // bus time of each queued element
+    uint64_t _poll_us;
+    TickType_t _recover_tick;
+
+    bool _ts_en;
+    uint16_t _ts_last;
+    uint64_t _ts_last_us;
+    uint64_t _ts_win_us;
+    uint32_t _ts_win_ticks;
+    time_sync_t _time_sync;
 };
 
+// Owns one statically allocated driver per bus. Handle -> driver and
+// which_can -> driver are table lookups, nothing is allocated at runtime,
+// and the isr callbacks only reach a driver once its init() has succeeded.
 class can_hub_t
 {
 
@@ -64,22 +494,59 @@ class can_hub_t
         can3
     };
 
-    static can_hub_t *get_instance(void);
+    // One entry per bus, in which_can order. The sizes are the ones fdcan.c
+    // is expected to configure, init() refuses a bus that does not match.
+    typedef struct bus_desc_t
+    {
+        FDCAN_HandleTypeDef *hfdcan;
+        which_can which;
+        uint8_t rx_fifo0_num;
+        uint8_t rx_buffer_num;
+        uint8_t tx_fifo_num;
+        uint8_t std_filter_num;
+        uint8_t ext_filter_num;
+    } bus_desc_t;
 
+    static can_hub_t *get_instance(void);
+    // -1 if hfdcan is not in the bus table
+    static int8_t bus_index(const FDCAN_HandleTypeDef *hfdcan);
+    static const bus_desc_t *get_bus_desc(uint8_t index);
 
+    // init() and start() on every bus in table order, then the monitor
+    status_t hub_start_all(void);
+    // Task that runs time sync, the health poll, including bus-off
+    // recovery, and tx_poll on every active bus. Independent of the tx
+    // scheduler; started by hub_start_all.
+    status_t hub_start_monitor(void);
     status_t hub_register_can_obj(FDCAN_HandleTypeDef *hfdcan,
                                   can_drv_t *can_drv);
     status_t hub_unregister_can_obj(FDCAN_HandleTypeDef *hfdcan);
     can_drv_t *hub_get_can_obj(which_can which_can);
-    status_t hub_handle_callback(FDCAN_HandleTypeDef *hfdcan,
-                                 uint32_t identifier, uint8_t *data);
+    status_t hub_handle_rx_fifo(FDCAN_HandleTypeDef *hfdcan,
+                                uint32_t rx_fifo, uint32_t rx_fifo_its = 0);
+    status_t hub_handle_rx_buffers(FDCAN_HandleTypeDef *hfdcan);
+    status_t hub_handle_tx_complete(FDCAN_HandleTypeDef *hfdcan,
+                                    uint32_t buffer_indexes);
+    status_t hub_handle_tx_event(FDCAN_HandleTypeDef *hfdcan,
+                                 uint32_t tx_event_its);
+    status_t hub_handle_error_status(FDCAN_HandleTypeDef *hfdcan,
+                                     uint32_t error_status_its);
+    void hub_health_poll(void);
+    void hub_tx_poll(void);
+    void hub_time_sync(void);
 
   private:
-    can_hub_t();
+    constexpr can_hub_t() : _active_mask(0)
+    {
+    }
     can_hub_t(const can_hub_t &)            = delete;
     can_hub_t &operator=(const can_hub_t &) = delete;
-    static can_hub_t *_instancePtr;
-    map_t<FDCAN_HandleTypeDef *, can_drv_t *> _can_drv_map;
+    can_drv_t *active_drv(FDCAN_HandleTypeDef *hfdcan);
+    static void monitor_task(void *arg);
+
+    static can_hub_t _instance;
+    // Bit per bus index, set by a successful init()
+    volatile uint32_t _active_mask;
 };
 }; // namespace pyro
 
@@ -0,0 +1,157 @@
+#include "pyro_can_filter.h"
+
+namespace pyro
+{
+namespace
+{
+typedef struct group_t
+{
+    uint8_t first; // index into the id list
+    uint8_t last;
+} group_t;
+
+uint8_t popcount(uint32_t v)
+{
+    uint8_t n = 0;
+    for (; v; v &= v - 1)
+        n++;
+    return n;
+}
+
+// Ids let through by covering ids[first..last] with one element, and the
+// element that does it with the fewest of them.
+uint32_t group_extra(const uint32_t *ids, const group_t &g, uint8_t id_bits,
+                     can_filter_elem_t *elem)
+{
+    uint8_t count = g.last - g.first + 1;
+    if (count <= 2)
+    {
+        if (elem)
+            *elem = {can_filter_dual, ids[g.first], ids[g.last]};
+        return 0;
+    }
+
+    uint32_t range_extra = ids[g.last] - ids[g.first] + 1 - count;
+
+    uint32_t diff = 0;
+    for (uint8_t i = g.first + 1; i <= g.last; i++)
+        diff |= ids[i] ^ ids[g.first];
+    uint8_t free_bits   = popcount(diff);
+    uint32_t mask_extra = (1UL << free_bits) - count;
+
+    if (range_extra <= mask_extra)
+    {
+        if (elem)
+            *elem = {can_filter_range, ids[g.first], ids[g.last]};
+        return range_extra;
+    }
+    if (elem)
+    {
+        uint32_t mask = ~diff & ((1UL << id_bits) - 1);
+        *elem         = {can_filter_mask, ids[g.first] & mask, mask};
+    }
+    return mask_extra;
+}
+
+uint8_t element_num(const group_t *groups, uint8_t group_num)
+{
+    uint8_t full = 0, single = 0;
+    for (uint8_t i = 0; i < group_num; i++)
+    {
+        if (groups[i].first == groups[i].last)
+            single++;
+        else
+            full++;
+    }
+    return full + (single + 1) / 2;
+}
+} // namespace
+
+uint8_t can_filter_pack(const uint32_t *ids, uint8_t id_num, uint8_t id_bits,
+                        can_filter_elem_t *elems, uint8_t elem_max,
+                        uint32_t *extra)
+{
+    group_t groups[CAN_FILTER_PACK_MAX];
+    uint8_t group_num = 0;
+
+    if (extra)
+        *extra = 0;
+    if (0 == id_num || 0 == elem_max || id_num > CAN_FILTER_PACK_MAX)
+        return 0;
+
+    // Maximal runs of consecutive ids
+    for (uint8_t i = 0; i < id_num; i++)
+    {
+        if (group_num && ids[i] == ids[groups[group_num - 1].last] + 1)
+            groups[group_num - 1].last = i;
+        else
+            groups[group_num++] = {i, i};
+    }
+
+    while (element_num(groups, group_num) > elem_max)
+    {
+        uint8_t before = element_num(groups, group_num);
+        int8_t best    = -1;
+        bool best_cuts = false;
+        int64_t best_cost  = INT64_MAX;
+
+        for (uint8_t i = 0; i + 1 < group_num; i++)
+        {
+            group_t merged = {groups[i].first, groups[i + 1].last};
+            int64_t cost   = (int64_t)group_extra(ids, merged, id_bits, nullptr) -
+                           group_extra(ids, groups[i], id_bits, nullptr) -
+                           group_extra(ids, groups[i + 1], id_bits, nullptr);
+
+            group_t trial[CAN_FILTER_PACK_MAX];
+            uint8_t n = 0;
+            for (uint8_t k = 0; k < group_num; k++)
+            {
+                if (k == i)
+                    trial[n++] = merged;
+                else if (k != i + 1)
+                    trial[n++] = groups[k];
+            }
+            bool cuts = element_num(trial, n) < before;
+
+            // Prefer merges that free an element, then the cheapest one
+            if ((cuts && !best_cuts) ||
+                (cuts == best_cuts && cost < best_cost))
+            {
+                best      = i;
+                best_cuts = cuts;
+                best_cost = cost;
+            }
+        }
+
+        groups[best].last = groups[best + 1].last;
+        for (uint8_t k = best + 1; k + 1 < group_num; k++)
+            groups[k] = groups[k + 1];
+        group_num--;
+    }
+
+    uint8_t elem_num = 0;
+    int16_t pending  = -1; // single id waiting for a dual partner
+    for (uint8_t i = 0; i < group_num; i++)
+    {
+        if (groups[i].first != groups[i].last)
+        {
+            uint32_t e = group_extra(ids, groups[i], id_bits,
+                                     &elems[elem_num++]);
+            if (extra)
+                *extra += e;
+        }
+        else if (pending < 0)
+            pending = groups[i].first;
+        else
+        {
+            elems[elem_num++] = {can_filter_dual, ids[pending],
+                                 ids[groups[i].first]};
+            pending           = -1;
+        }
+    }
+    if (pending >= 0)
+        elems[elem_num++] = {can_filter_dual, ids[pending], ids[pending]};
+
+    return elem_num;
+}
+} // namespace pyro
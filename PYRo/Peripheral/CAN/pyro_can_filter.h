@@ -0,0 +1,45 @@
+#ifndef __PYRO_CAN_FILTER_H__
+#define __PYRO_CAN_FILTER_H__
+
+#include "pyro_core_config.h"
+
+#include <cstdint>
+
+namespace pyro
+{
+// Largest id set a single pack call accepts.
+constexpr uint8_t CAN_FILTER_PACK_MAX =
+    CAN_RX_ID_MAX_NUM > CAN_RX_EXT_ID_MAX_NUM ? CAN_RX_ID_MAX_NUM
+                                              : CAN_RX_EXT_ID_MAX_NUM;
+
+enum can_filter_type_t
+{
+    can_filter_range, // id1 <= id <= id2
+    can_filter_dual,  // id == id1 || id == id2
+    can_filter_mask   // (id & id2) == id1
+};
+
+typedef struct can_filter_elem_t
+{
+    can_filter_type_t type;
+    uint32_t id1;
+    uint32_t id2;
+} can_filter_elem_t;
+
+/*
+ * Packs a sorted, duplicate free id list into at most elem_max acceptance
+ * filter elements. Runs of consecutive ids become range elements and the
+ * remaining single ids are paired into dual elements, which is the smallest
+ * exact cover. If that still needs more than elem_max elements, neighbouring
+ * groups are merged into range or mask elements, picking the merge that lets
+ * through the fewest unregistered ids; those are then rejected in software.
+ *
+ * id_bits is 11 for standard and 29 for extended ids. Returns the number of
+ * elements written, *extra receives the count of unregistered ids accepted.
+ */
+uint8_t can_filter_pack(const uint32_t *ids, uint8_t id_num, uint8_t id_bits,
+                        can_filter_elem_t *elems, uint8_t elem_max,
+                        uint32_t *extra);
+} // namespace pyro
+
+#endif
@@ -0,0 +1,193 @@
+#include "pyro_can_planner.h"
+
+namespace pyro
+{
+can_planner_t can_planner_t::_instance;
+
+can_planner_t *can_planner_t::get_instance(void)
+{
+    return &_instance;
+}
+
+uint32_t can_planner_t::frame_bits(uint8_t len, bool extended, bool fd,
+                                   uint32_t *data_bits)
+{
+    uint32_t bits;
+    uint32_t fast = 0;
+    if (!fd)
+    {
+        // SOF .. CRC is stuffed, then CRC delimiter, ACK, EOF, intermission
+        uint32_t stuffed = (extended ? 54 : 34) + 8 * len;
+        bits             = stuffed + (stuffed - 1) / 4 + 13;
+    }
+    else
+    {
+        // SOF .. BRS at the nominal rate
+        uint32_t arb = extended ? 36 : 17;
+        // ESI, DLC, data, stuff count, CRC with its fixed stuff bits
+        uint32_t crc = len > 16 ? 21 : 17;
+        fast = 5 + 8 * len + (4 + 8 * len) / 4 + 4 + crc + (crc + 3) / 4;
+        bits = arb + (arb - 1) / 4 + fast + 13;
+    }
+    if (data_bits)
+        *data_bits = fast;
+    return bits;
+}
+
+void can_planner_t::set_bit_time(uint8_t bus, uint32_t nom_bit_ns,
+                                 uint32_t data_bit_ns)
+{
+    if (bus >= CAN_BUS_NUM)
+        return;
+    _bus[bus].plan.nom_bit_ns  = nom_bit_ns;
+    _bus[bus].plan.data_bit_ns = data_bit_ns;
+}
+
+status_t can_planner_t::add_flow(uint8_t bus, uint32_t id, uint8_t len,
+                                 uint16_t rate_hz, dir_t dir, bool extended,
+                                 bool fd, bool brs)
+{
+    if (bus >= CAN_BUS_NUM || 0 == rate_hz)
+        return PYRO_PARAM_ERROR;
+
+    bus_t &b = _bus[bus];
+    for (uint8_t i = 0; i < b.plan.flow_num; i++)
+    {
+        flow_t &flow = b.flows[i];
+        if (flow.id == id && flow.extended == extended && flow.dir == dir)
+        {
+            if (rate_hz > flow.rate_hz)
+                flow.rate_hz = rate_hz;
+            if (len > flow.len)
+                flow.len = len;
+            return PYRO_OK;
+        }
+    }
+    if (b.plan.flow_num >= CAN_PLAN_FLOW_MAX)
+        return PYRO_NO_MEMORY;
+    b.flows[b.plan.flow_num++] = {id, extended, fd, brs, dir, len, rate_hz,
+                                  0,  0};
+    return PYRO_OK;
+}
+
+void can_planner_t::clear(uint8_t bus)
+{
+    if (bus < CAN_BUS_NUM)
+        _bus[bus].plan.flow_num = 0;
+}
+
+status_t can_planner_t::analyse(void)
+{
+    status_t ret = PYRO_OK;
+    for (bus_t &bus : _bus)
+    {
+        analyse_bus(bus);
+        if (bus.plan.overload)
+            ret = PYRO_WARNING;
+    }
+    return ret;
+}
+
+const can_planner_t::bus_plan_t &can_planner_t::get_plan(uint8_t bus)
+{
+    return _bus[bus < CAN_BUS_NUM ? bus : 0].plan;
+}
+
+const can_planner_t::flow_t *can_planner_t::get_flows(uint8_t bus,
+                                                      uint8_t &num)
+{
+    if (bus >= CAN_BUS_NUM)
+    {
+        num = 0;
+        return nullptr;
+    }
+    num = _bus[bus].plan.flow_num;
+    return _bus[bus].flows;
+}
+
+// True if a wins arbitration against b. A standard id beats an extended id
+// with the same leading 11 bits.
+bool can_planner_t::precedes(const flow_t &a, const flow_t &b)
+{
+    uint32_t key_a = a.extended ? a.id : a.id << 18;
+    uint32_t key_b = b.extended ? b.id : b.id << 18;
+    return key_a < key_b || (key_a == key_b && !a.extended && b.extended);
+}
+
+// Response time of frame m (Davis, Burns, Bril, Lukkien 2007):
+//   w = B + sum over higher priority k of ceil((w + bit) / T_k) * C_k
+//   R = w + C_m
+// B is the longest lower priority frame, which may have just started. Our
+// own tx frames leave through a fifo rather than by id, so every other tx
+// flow counts as higher priority for a tx flow.
+void can_planner_t::analyse_bus(bus_t &bus)
+{
+    bus_plan_t &plan = bus.plan;
+    uint32_t nom_ns  = plan.nom_bit_ns ? plan.nom_bit_ns : 1000;
+    uint32_t data_ns = plan.data_bit_ns ? plan.data_bit_ns : nom_ns;
+    uint64_t load    = 0;
+
+    for (uint8_t i = 0; i < plan.flow_num; i++)
+    {
+        flow_t &flow = bus.flows[i];
+        uint32_t fast;
+        uint32_t bits = frame_bits(flow.len, flow.extended, flow.fd, &fast);
+        flow.frame_ns = flow.brs ? (bits - fast) * nom_ns + fast * data_ns
+                                 : bits * nom_ns;
+        load += static_cast<uint64_t>(flow.frame_ns) * flow.rate_hz;
+    }
+    plan.load_permille     = static_cast<uint16_t>(load / 1000000U);
+    plan.worst_response_us = 0;
+    plan.worst_id          = 0;
+    plan.miss_num          = 0;
+
+    for (uint8_t m = 0; m < plan.flow_num; m++)
+    {
+        flow_t &flow       = bus.flows[m];
+        uint64_t period_ns = 1000000000ULL / flow.rate_hz;
+        uint64_t blocking  = 0;
+        bool hp[CAN_PLAN_FLOW_MAX];
+
+        for (uint8_t k = 0; k < plan.flow_num; k++)
+        {
+            const flow_t &other = bus.flows[k];
+            hp[k] = k != m && (precedes(other, flow) ||
+                               (dir_tx == flow.dir && dir_tx == other.dir));
+            if (k != m && !hp[k] && other.frame_ns > blocking)
+                blocking = other.frame_ns;
+        }
+
+        uint64_t w = blocking;
+        for (uint8_t iter = 0; iter < 64; iter++)
+        {
+            uint64_t next = blocking;
+            for (uint8_t k = 0; k < plan.flow_num; k++)
+            {
+                if (!hp[k])
+                    continue;
+                uint64_t t_k = 1000000000ULL / bus.flows[k].rate_hz;
+                next += (w + nom_ns + t_k - 1) / t_k * bus.flows[k].frame_ns;
+            }
+            if (next == w || next + flow.frame_ns > period_ns)
+            {
+                w = next;
+                break;
+            }
+            w = next;
+        }
+
+        uint64_t response_ns = w + flow.frame_ns;
+        flow.response_us     = static_cast<uint32_t>(response_ns / 1000);
+        if (response_ns > period_ns)
+            plan.miss_num++;
+        if (flow.response_us > plan.worst_response_us)
+        {
+            plan.worst_response_us = flow.response_us;
+            plan.worst_id          = flow.id;
+        }
+    }
+
+    plan.overload =
+        plan.load_permille >= CAN_PLAN_WARN_PERMILLE || plan.miss_num > 0;
+}
+} // namespace pyro
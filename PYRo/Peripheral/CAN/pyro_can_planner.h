@@ -0,0 +1,88 @@
+#ifndef CAN_PLANNER_H
+#define CAN_PLANNER_H
+
+#include "pyro_core_config.h"
+#include "pyro_core_def.h"
+
+#include <cstdint>
+
+namespace pyro
+{
+// Bus budget from the expected traffic: utilisation and the worst case
+// response time of every frame, using the classic CAN schedulability test.
+// No HAL or RTOS calls, so the same code can be built into a host tool.
+// Flows are added from one task while setting up; analyse() afterwards.
+class can_planner_t
+{
+  public:
+    enum dir_t
+    {
+        dir_rx,
+        dir_tx
+    };
+
+    typedef struct flow_t
+    {
+        uint32_t id;
+        bool extended;
+        bool fd;
+        bool brs;
+        dir_t dir;
+        uint8_t len;
+        uint16_t rate_hz;
+        uint32_t frame_ns;    // filled by analyse()
+        uint32_t response_us; // queued until fully on the bus, worst case
+    } flow_t;
+
+    typedef struct bus_plan_t
+    {
+        uint32_t nom_bit_ns;
+        uint32_t data_bit_ns;
+        uint8_t flow_num;
+        uint16_t load_permille;
+        uint32_t worst_response_us;
+        uint32_t worst_id;
+        uint8_t miss_num; // flows whose response exceeds their period
+        bool overload;
+    } bus_plan_t;
+
+    static can_planner_t *get_instance(void);
+
+    // Bits on the wire with worst case stuffing; data_bits is the part sent
+    // at the data bit rate when brs is used
+    static uint32_t frame_bits(uint8_t len, bool extended, bool fd,
+                               uint32_t *data_bits = nullptr);
+
+    void set_bit_time(uint8_t bus, uint32_t nom_bit_ns, uint32_t data_bit_ns);
+    // The same id and direction added again keeps the larger rate and length
+    status_t add_flow(uint8_t bus, uint32_t id, uint8_t len, uint16_t rate_hz,
+                      dir_t dir, bool extended = false, bool fd = false,
+                      bool brs = false);
+    void clear(uint8_t bus);
+    // PYRO_WARNING if any bus is overloaded
+    status_t analyse(void);
+    const bus_plan_t &get_plan(uint8_t bus);
+    const flow_t *get_flows(uint8_t bus, uint8_t &num);
+
+  private:
+    typedef struct bus_t
+    {
+        bus_plan_t plan;
+        flow_t flows[CAN_PLAN_FLOW_MAX];
+    } bus_t;
+
+    constexpr can_planner_t() : _bus()
+    {
+    }
+    can_planner_t(const can_planner_t &)            = delete;
+    can_planner_t &operator=(const can_planner_t &) = delete;
+
+    void analyse_bus(bus_t &bus);
+    static bool precedes(const flow_t &a, const flow_t &b);
+
+    static can_planner_t _instance;
+    bus_t _bus[CAN_BUS_NUM];
+};
+} // namespace pyro
+
+#endif
@@ -0,0 +1,131 @@
+#ifndef __PYRO_CAN_RX_TABLE_H__
+#define __PYRO_CAN_RX_TABLE_H__
+
+#include "pyro_core_config.h"
+#include "pyro_core_def.h"
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+
+namespace pyro
+{
+// Id -> first subscriber lookup of the CAN rx path. A standard id indexes a
+// table of 8 bit slots directly, so the lookup is two loads however many
+// ids are registered; extended ids are kept sorted for a binary search.
+// No HAL or RTOS calls, so the host benchmark runs the same code. Lookups
+// come from the rx isr, the caller keeps it out while add() runs.
+template <typename T> class can_rx_table_t
+{
+  public:
+    static constexpr uint16_t STD_ID_NUM = 0x800;
+    using slot_t                         = uint8_t;
+
+    static_assert(CAN_RX_ID_MAX_NUM < 255, "rx slot index is 8 bit");
+
+    can_rx_table_t() : _slots(nullptr), _std_num(0), _ext_num(0)
+    {
+        _msgs.fill(nullptr);
+        _ext.fill({0, nullptr});
+    }
+    can_rx_table_t(const can_rx_table_t &)            = delete;
+    can_rx_table_t &operator=(const can_rx_table_t &) = delete;
+
+    // STD_ID_NUM slots owned by the caller, nullptr for no standard ids
+    void attach(slot_t *slots)
+    {
+        _slots = slots;
+        if (_slots)
+            memset(_slots, 0, STD_ID_NUM * sizeof(slot_t));
+    }
+
+    // The caller checks for an id that is already registered
+    status_t add(uint32_t id, bool extended, T *msg)
+    {
+        if (!extended)
+        {
+            if (nullptr == _slots || id >= STD_ID_NUM)
+                return PYRO_PARAM_ERROR;
+            if (_std_num >= CAN_RX_ID_MAX_NUM)
+                return PYRO_NO_MEMORY;
+            _msgs[++_std_num] = msg;
+            _slots[id]        = _std_num;
+            return PYRO_OK;
+        }
+        if (_ext_num >= CAN_RX_EXT_ID_MAX_NUM)
+            return PYRO_NO_MEMORY;
+        uint8_t pos = 0;
+        while (pos < _ext_num && _ext[pos].id < id)
+            pos++;
+        for (uint8_t i = _ext_num; i > pos; i--)
+            _ext[i] = _ext[i - 1];
+        _ext[pos] = {id, msg};
+        _ext_num++;
+        return PYRO_OK;
+    }
+
+    // Slot 0 is the empty entry and always maps to nullptr
+    T *find_std(uint32_t id) const
+    {
+        return _slots ? _msgs[_slots[id & (STD_ID_NUM - 1)]] : nullptr;
+    }
+
+    T *find_ext(uint32_t id) const
+    {
+        uint8_t lo = 0;
+        uint8_t hi = _ext_num;
+        while (lo < hi)
+        {
+            uint8_t mid = (lo + hi) >> 1;
+            if (_ext[mid].id < id)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        if (lo < _ext_num && _ext[lo].id == id)
+            return _ext[lo].msg;
+        return nullptr;
+    }
+
+    T *find(uint32_t id, bool extended) const
+    {
+        if (extended)
+            return find_ext(id);
+        return id < STD_ID_NUM ? find_std(id) : nullptr;
+    }
+
+    // Registered ids in ascending order, for the filter packer
+    uint8_t std_ids(uint32_t *ids) const
+    {
+        uint8_t num = 0;
+        for (uint16_t id = 0; _slots && id < STD_ID_NUM; id++)
+        {
+            if (_slots[id])
+                ids[num++] = id;
+        }
+        return num;
+    }
+
+    uint8_t ext_ids(uint32_t *ids) const
+    {
+        for (uint8_t i = 0; i < _ext_num; i++)
+            ids[i] = _ext[i].id;
+        return _ext_num;
+    }
+
+  private:
+    typedef struct ext_entry_t
+    {
+        uint32_t id;
+        T *msg;
+    } ext_entry_t;
+
+    slot_t *_slots;
+    std::array<T *, CAN_RX_ID_MAX_NUM + 1> _msgs;
+    uint8_t _std_num;
+    std::array<ext_entry_t, CAN_RX_EXT_ID_MAX_NUM> _ext;
+    uint8_t _ext_num;
+};
+} // namespace pyro
+
+#endif
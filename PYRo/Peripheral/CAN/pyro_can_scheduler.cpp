@@ -0,0 +1,145 @@
+#include "pyro_can_scheduler.h"
+#include "pyro_core_time.h"
+#include "task.h"
+
+#include <cstring>
+
+namespace pyro
+{
+static StackType_t can_sched_stack[CAN_SCHED_STACK_SIZE];
+static StaticTask_t can_sched_tcb;
+
+can_scheduler_t can_scheduler_t::_instance;
+
+can_scheduler_t *can_scheduler_t::get_instance(void)
+{
+    return &_instance;
+}
+
+status_t can_scheduler_t::start(void)
+{
+    if (_task_handle)
+        return PYRO_OK;
+    _task_handle = xTaskCreateStatic(flush_task, "can_sched",
+                                     CAN_SCHED_STACK_SIZE, this,
+                                     CAN_SCHED_PRIORITY, can_sched_stack,
+                                     &can_sched_tcb);
+    return _task_handle ? PYRO_OK : PYRO_ERROR;
+}
+
+// Highest priority and woken by the tick, so the burst always starts right
+// at the tick boundary and frames computed in tick n leave in tick n + 1
+void can_scheduler_t::flush_task(void *arg)
+{
+    can_scheduler_t *self = static_cast<can_scheduler_t *>(arg);
+    TickType_t wake       = xTaskGetTickCount();
+    while (true)
+    {
+        vTaskDelayUntil(&wake, pdMS_TO_TICKS(CAN_SCHED_PERIOD_MS));
+        self->flush();
+    }
+}
+
+status_t can_scheduler_t::stage(can_hub_t::which_can which, uint32_t id,
+                                const uint8_t *data)
+{
+    if (which >= CAN_BUS_NUM || !data)
+        return PYRO_PARAM_ERROR;
+
+    bus_t &bus       = _bus[which];
+    status_t ret     = PYRO_OK;
+    UBaseType_t mask = portSET_INTERRUPT_MASK_FROM_ISR();
+
+    uint8_t i = 0;
+    while (i < bus.slot_num && bus.slots[i].id < id)
+        i++;
+    if (i == bus.slot_num || bus.slots[i].id != id)
+    {
+        // First frame for this id, slots stay sorted and are never removed
+        if (bus.slot_num >= CAN_SCHED_SLOT_NUM)
+        {
+            ret = PYRO_NO_MEMORY;
+        }
+        else
+        {
+            for (uint8_t j = bus.slot_num; j > i; j--)
+                bus.slots[j] = bus.slots[j - 1];
+            bus.slots[i].id = id;
+            bus.slot_num++;
+        }
+    }
+    if (PYRO_OK == ret)
+    {
+        memcpy(bus.slots[i].data, data, 8);
+        bus.slots[i].pending = true;
+    }
+
+    portCLEAR_INTERRUPT_MASK_FROM_ISR(mask);
+    return ret;
+}
+
+void can_scheduler_t::flush(void)
+{
+    for (uint8_t which = 0; which < CAN_BUS_NUM; which++)
+    {
+        bus_t &bus = _bus[which];
+        if (!bus.drv)
+            bus.drv = can_hub_t::get_instance()->hub_get_can_obj(
+                static_cast<can_hub_t::which_can>(which));
+        if (!bus.drv)
+            continue;
+
+        update_burst_stats(bus);
+
+        uint64_t flush_us = pyro_time_us();
+        uint32_t sent     = 0;
+        for (uint8_t i = 0; i < bus.slot_num; i++)
+        {
+            slot_t &slot = bus.slots[i];
+            if (!slot.pending)
+                continue;
+
+            uint8_t data[8];
+            UBaseType_t mask = portSET_INTERRUPT_MASK_FROM_ISR();
+            memcpy(data, slot.data, 8);
+            slot.pending = false;
+            portCLEAR_INTERRUPT_MASK_FROM_ISR(mask);
+
+            if (PYRO_OK == bus.drv->send_msg(slot.id, data))
+                sent++;
+            else
+                bus.stats.reject_num++;
+        }
+        if (sent)
+        {
+            bus.flush_us   = flush_us;
+            bus.flush_sent = sent;
+        }
+    }
+}
+
+// The last burst is finished by the time the next flush runs, close it
+// with the driver's last tx complete time
+void can_scheduler_t::update_burst_stats(bus_t &bus)
+{
+    if (!bus.flush_sent)
+        return;
+    uint64_t done_us = bus.drv->get_last_tx_complete_us();
+    if (done_us >= bus.flush_us)
+    {
+        uint32_t duration = static_cast<uint32_t>(done_us - bus.flush_us);
+        bus.stats.last_us = duration;
+        if (duration > bus.stats.max_us)
+            bus.stats.max_us = duration;
+    }
+    bus.stats.frame_num = bus.flush_sent;
+    bus.stats.burst_num++;
+    bus.flush_sent = 0;
+}
+
+const can_scheduler_t::burst_stats_t &
+can_scheduler_t::get_burst_stats(can_hub_t::which_can which)
+{
+    return _bus[which < CAN_BUS_NUM ? which : 0].stats;
+}
+} // namespace pyro
@@ -0,0 +1,69 @@
+#ifndef CAN_SCHEDULER_H
+#define CAN_SCHEDULER_H
+
+#include "pyro_can_drv.h"
+
+namespace pyro
+{
+// Collects the tx frames produced during one control tick and sends them as
+// a single burst per bus at a fixed phase of the cycle. A frame staged again
+// for the same id before the flush replaces the older one, so each id goes
+// out at most once per tick. Frames are sent in ascending id order, which
+// is also the order they win arbitration.
+class can_scheduler_t
+{
+  public:
+    typedef struct burst_stats_t
+    {
+        uint32_t burst_num;
+        uint32_t frame_num;    // frames in the last burst
+        uint32_t last_us;      // flush start -> last tx complete
+        uint32_t max_us;
+        uint32_t reject_num;   // frames the driver did not accept
+    } burst_stats_t;
+
+    static can_scheduler_t *get_instance(void);
+
+    // Creates the flush task, woken every CAN_SCHED_PERIOD_MS ticks
+    status_t start(void);
+    status_t stage(can_hub_t::which_can which, uint32_t id,
+                   const uint8_t *data);
+    // Called by the flush task, may also be called directly from a control
+    // loop that wants to own the phase itself
+    void flush(void);
+    const burst_stats_t &get_burst_stats(can_hub_t::which_can which);
+
+  private:
+    typedef struct slot_t
+    {
+        uint32_t id;
+        uint8_t data[8];
+        bool pending;
+    } slot_t;
+
+    typedef struct bus_t
+    {
+        std::array<slot_t, CAN_SCHED_SLOT_NUM> slots; // sorted by id
+        uint8_t slot_num;
+        can_drv_t *drv;
+        uint64_t flush_us;
+        uint32_t flush_sent;
+        burst_stats_t stats;
+    } bus_t;
+
+    constexpr can_scheduler_t() : _bus(), _task_handle(nullptr)
+    {
+    }
+    can_scheduler_t(const can_scheduler_t &)            = delete;
+    can_scheduler_t &operator=(const can_scheduler_t &) = delete;
+
+    static void flush_task(void *arg);
+    void update_burst_stats(bus_t &bus);
+
+    static can_scheduler_t _instance;
+    std::array<bus_t, CAN_BUS_NUM> _bus;
+    TaskHandle_t _task_handle;
+};
+} // namespace pyro
+
+#endif
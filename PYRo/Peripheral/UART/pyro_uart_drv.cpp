@@ -2,9 +2,9 @@
  * @file PYRo_uart_drv.cpp
  * @brief Implementation file for the PYRO C++ UART Driver class.
  *
- * This file implements the `pyro::uart_drv_t` methods, including DMA buffer
- * allocation, transmission logic, and the critical static map mechanism
- * to link HAL ISR callbacks to the correct C++ driver instance.
+ * This file implements the `pyro::uart_drv_t` methods, including the static
+ * driver set built from the UART table, transmission logic, and the lookup
+ * that links HAL ISR callbacks to the correct C++ driver instance.
  *
  * @author Lucky
  * @version 1.0.0
@@ -17,82 +17,83 @@
 #include "stm32h7xx_hal_dma.h"
 
 #include <cstring>
-#include <map>
+#include <utility>
 
 #include "pyro_core_dma_heap.h"
 #include "pyro_uart_drv.h"
+#include "pyro_uart_table.h"
+#include "task.h"
 #include "usart.h"
 
-#include <stdexcept>
-
 namespace pyro
 {
-/* Constructor and Destructor ------------------------------------------------*/
-/**
- * @brief Constructor for the UART driver.
- *
- * Allocates two DMA-capable buffers, registers the instance in the static map,
- * and initializes state flags.
- */
-uart_drv_t::uart_drv_t(UART_HandleTypeDef *huart, const uint16_t buf_length)
-    : rx_buf{nullptr, nullptr}, _huart(huart)
+/* UART Table ----------------------------------------------------------------*/
+static constexpr uint8_t UART_NUM =
+    sizeof(uart_desc_table) / sizeof(uart_desc_table[0]);
+
+static constexpr bool uart_table_valid()
 {
-    uart_map()[huart] = this;
-    rx_buf[0]         = static_cast<uint8_t *>(pvPortDmaMalloc(buf_length));
-    rx_buf[1]         = static_cast<uint8_t *>(pvPortDmaMalloc(buf_length));
-    if (rx_buf[0] && rx_buf[1])
+    for (uint8_t i = 0; i < UART_NUM; i++)
     {
-        state.init_flag = true;
-        memset(rx_buf[0], 0, buf_length);
-        memset(rx_buf[1], 0, buf_length);
-        _rx_buf_size = buf_length;
+        const uart_drv_t::desc_t &desc = uart_desc_table[i];
+        if (desc.which != i || 0 == desc.rx_buf_len)
+            return false;
+        if (uart_drv_t::rx_mode_ring == desc.rx_mode && desc.rx_ring_len < 2)
+            return false;
     }
-    rx_buf_switch = 0;
+    return true;
 }
+static_assert(uart_table_valid(),
+              "uart table rows follow which_uart, ring mode needs a ring");
 
-/**
- * @brief Destructor.
- *
- * Frees DMA-allocated buffers and removes the instance from the static map.
- */
-uart_drv_t::~uart_drv_t()
+static constexpr uint32_t uart_dma_offset(const uint8_t index)
 {
-    if (rx_buf[0])
+    uint32_t offset = 0;
+    for (uint8_t i = 0; i < index; i++)
     {
-        vPortFree(rx_buf[0]);
-        rx_buf[0] = nullptr;
+        offset += uart_drv_t::dma_size(uart_desc_table[i]);
     }
-    if (rx_buf[1])
+    return offset;
+}
+
+// RX buffers, rings and TX copy rings of every UART, placed in RAM_D2 by the
+// linker script, since DMA1 cannot reach DTCM
+__attribute__((section(".dma_buffer"), aligned(DMA_CACHE_LINE_SIZE)))
+static uint8_t uart_dma_pool[uart_dma_offset(UART_NUM)];
+
+template <typename Seq> struct uart_drv_set_t;
+template <size_t... I> struct uart_drv_set_t<std::index_sequence<I...>>
+{
+    uart_drv_t drv[sizeof...(I)]{
+        uart_drv_t(uart_desc_table[I], uart_dma_pool + uart_dma_offset(I))...};
+};
+
+// Constant initialised: no constructor runs and no init guard is checked
+static uart_drv_set_t<std::make_index_sequence<UART_NUM>> uart_drvs;
+
+static int8_t uart_index(const UART_HandleTypeDef *huart)
+{
+    for (uint8_t i = 0; i < UART_NUM; i++)
     {
-        vPortFree(rx_buf[1]);
-        rx_buf[1] = nullptr;
+        if (uart_desc_table[i].huart == huart)
+            return static_cast<int8_t>(i);
     }
-    uart_map().erase(_huart);
+    return -1;
 }
 
+/* Instance Lookup -----------------------------------------------------------*/
 uart_drv_t *uart_drv_t::get_instance(const which_uart uart)
 {
-    static uart_drv_t uart_drv1(&huart1, 42);
-    static uart_drv_t uart_drv5(&huart5, 36);
-    switch (uart)
-    {
-        case uart1:
-            return &uart_drv1;
-        case uart5:
-            return &uart_drv5;
-        default:
-            return nullptr;
-    }
+    return uart < UART_NUM ? &uart_drvs.drv[uart] : nullptr;
 }
-/* Static Map Management -----------------------------------------------------*/
+
 /**
- * @brief Provides access to the static map linking HAL handles to driver
- * instances.
+ * @brief Looks up the driver bound to a HAL handle (safe in ISR context).
  */
-std::map<UART_HandleTypeDef *, uart_drv_t *> &uart_drv_t::uart_map()
+uart_drv_t *uart_drv_t::find(const UART_HandleTypeDef *huart)
 {
-    static std::map<UART_HandleTypeDef *, uart_drv_t *> instance;
-    return instance;
+    const int8_t index = uart_index(huart);
+    return index < 0 ? nullptr : &uart_drvs.drv[index];
 }
 
 /* Transmission Methods ------------------------------------------------------*/
@@ -122,21 +123,211 @@ status_t uart_drv_t::write(const uint8_t *p, const uint16_t size,
 }
 
 /**
- * @brief Non-blocking write using HAL DMA. Updates state flags on busy status.
+ * @brief Non-blocking write, copied into the TX ring and queued for DMA.
+ *
+ * The caller's buffer is free again on return. Transfers are chained from
+ * the TX complete interrupt, so several tasks can share one UART.
+ * @return PYRO_BUSY if the queue or the copy ring is full.
  */
 status_t uart_drv_t::write(const uint8_t *p, const uint16_t size)
 {
-    const uint8_t ret = HAL_UART_Transmit_DMA(_huart, p, size);
-    if (ret == HAL_OK)
+    if (nullptr == p || 0 == size || size > UART_TX_BUF_LEN)
     {
-        return PYRO_OK;
+        return PYRO_PARAM_ERROR;
     }
-    if (ret == HAL_BUSY)
+    if (nullptr == _tx_buf)
+    {
+        return PYRO_NO_MEMORY;
+    }
+    uint8_t *copy;
+    tx_desc_t *desc = tx_reserve(size, &copy);
+    if (nullptr == desc)
     {
-        state.tx_busy = 0x01U;
         return PYRO_BUSY;
     }
-    return PYRO_ERROR;
+    memcpy(copy, p, size);
+    tx_submit(desc);
+    return PYRO_OK;
+}
+
+/**
+ * @brief Non-blocking write straight from the caller's buffer.
+ *
+ * p must be DMA-capable and stay untouched until done(ctx, p) runs, also
+ * when the transfer fails. That is the TX complete interrupt, or this call
+ * itself if the transfer can not be started.
+ */
+status_t uart_drv_t::write_ref(const uint8_t *p, const uint16_t size,
+                               const tx_done_func done, void *ctx)
+{
+    if (nullptr == p || 0 == size)
+    {
+        return PYRO_PARAM_ERROR;
+    }
+    tx_desc_t *desc = tx_reserve(size, nullptr);
+    if (nullptr == desc)
+    {
+        return PYRO_BUSY;
+    }
+    desc->data = p;
+    desc->done = done;
+    desc->ctx  = ctx;
+    tx_submit(desc);
+    return PYRO_OK;
+}
+
+const uart_drv_t::tx_stats_t &uart_drv_t::get_tx_stats() const
+{
+    return _tx_stats;
+}
+
+/**
+ * @brief Takes the next descriptor and, for copies, size contiguous bytes
+ * of the copy ring. A copy that would cross the ring end skips the rest of
+ * it and starts at the head; the gap is released with the frame.
+ */
+uart_drv_t::tx_desc_t *uart_drv_t::tx_reserve(const uint16_t size,
+                                              uint8_t **copy_to)
+{
+    static_assert((UART_TX_BUF_LEN & (UART_TX_BUF_LEN - 1)) == 0,
+                  "UART_TX_BUF_LEN must be a power of 2");
+    tx_desc_t *desc = nullptr;
+    taskENTER_CRITICAL();
+    const uint32_t queued = _tx_desc_head - _tx_desc_tail;
+    uint32_t start        = _tx_buf_head;
+    uint32_t end          = start;
+    if (copy_to)
+    {
+        const uint32_t offset = start & (UART_TX_BUF_LEN - 1);
+        if (offset + size > UART_TX_BUF_LEN)
+        {
+            start += UART_TX_BUF_LEN - offset;
+        }
+        end = start + size;
+    }
+    if (queued < UART_TX_DESC_NUM && end - _tx_buf_tail <= UART_TX_BUF_LEN)
+    {
+        desc              = &_tx_desc[_tx_desc_head % UART_TX_DESC_NUM];
+        desc->data        = nullptr;
+        desc->len         = size;
+        desc->ready       = false;
+        desc->buf_release = end;
+        desc->done        = nullptr;
+        desc->ctx         = nullptr;
+        if (copy_to)
+        {
+            *copy_to   = _tx_buf + (start & (UART_TX_BUF_LEN - 1));
+            desc->data = *copy_to;
+        }
+        _tx_buf_head = end;
+        _tx_desc_head++;
+        if (queued + 1 > _tx_stats.queue_max)
+        {
+            _tx_stats.queue_max = queued + 1;
+        }
+    }
+    else
+    {
+        _tx_stats.full_num++;
+    }
+    taskEXIT_CRITICAL();
+    return desc;
+}
+
+/**
+ * @brief Marks a filled descriptor ready and starts it if the line is idle.
+ */
+void uart_drv_t::tx_submit(tx_desc_t *desc)
+{
+    tx_done_t failed[UART_TX_DESC_NUM];
+    uint8_t failed_num = 0;
+    taskENTER_CRITICAL();
+    desc->ready = true;
+    tx_kick(failed, failed_num);
+    taskEXIT_CRITICAL();
+    tx_notify(failed, failed_num, nullptr);
+}
+
+/**
+ * @brief Starts the oldest descriptor if nothing is in flight. Called with
+ * interrupts masked. A later descriptor that is ready waits for the older
+ * ones, so frames leave in the order they were reserved. Descriptors that
+ * fail to start are appended to failed for the caller to notify.
+ */
+void uart_drv_t::tx_kick(tx_done_t *failed, uint8_t &failed_num)
+{
+    while (!_tx_active && _tx_desc_tail != _tx_desc_head)
+    {
+        tx_desc_t &desc = _tx_desc[_tx_desc_tail % UART_TX_DESC_NUM];
+        if (!desc.ready)
+        {
+            return;
+        }
+        vPortDmaCacheClean(desc.data, desc.len);
+        if (HAL_OK == HAL_UART_Transmit_DMA(_huart, desc.data, desc.len))
+        {
+            _tx_active = true;
+            return;
+        }
+        // e.g. a polling write() holds the UART: drop it, keep the queue going
+        _tx_stats.error_num++;
+        if (desc.done)
+        {
+            failed[failed_num++] = {desc.done, desc.ctx, desc.data};
+        }
+        _tx_buf_tail = desc.buf_release;
+        _tx_desc_tail++;
+    }
+}
+
+/**
+ * @brief Calls done for retired descriptors, with interrupts unmasked.
+ */
+void uart_drv_t::tx_notify(const tx_done_t *list, const uint8_t num,
+                           BaseType_t *woken)
+{
+    for (uint8_t i = 0; i < num; i++)
+    {
+        list[i].done(list[i].ctx, list[i].data, woken);
+    }
+}
+
+/**
+ * @brief Retires the transfer in flight and chains the next one (ISR).
+ *
+ * failed is set from the error callback when the DMA transfer was aborted.
+ */
+void uart_drv_t::handle_tx_cplt(BaseType_t *woken, const bool failed)
+{
+    const UBaseType_t mask = portSET_INTERRUPT_MASK_FROM_ISR();
+    if (!_tx_active)
+    {
+        portCLEAR_INTERRUPT_MASK_FROM_ISR(mask);
+        return;
+    }
+    // The finished transfer first, then any that fail to start after it
+    tx_done_t retired[UART_TX_DESC_NUM];
+    uint8_t retired_num   = 0;
+    const tx_desc_t &desc = _tx_desc[_tx_desc_tail % UART_TX_DESC_NUM];
+    if (desc.done)
+    {
+        retired[retired_num++] = {desc.done, desc.ctx, desc.data};
+    }
+    if (failed)
+    {
+        _tx_stats.error_num++;
+    }
+    else
+    {
+        _tx_stats.frame_num++;
+        _tx_stats.byte_num += desc.len;
+    }
+    _tx_buf_tail = desc.buf_release;
+    _tx_desc_tail++;
+    _tx_active = false;
+    tx_kick(retired, retired_num);
+    portCLEAR_INTERRUPT_MASK_FROM_ISR(mask);
+    tx_notify(retired, retired_num, woken);
 }
 
 /* Reception Control Methods -------------------------------------------------*/
@@ -153,6 +344,16 @@ status_t uart_drv_t::enable_rx_dma()
     {
         return PYRO_ERROR;
     }
+    if (rx_mode_ring == _rx_mode)
+    {
+        return start_rx_ring();
+    }
+    if (PYRO_OK != set_dma_mode(DMA_NORMAL))
+    {
+        return PYRO_ERROR;
+    }
+    // drop lines the CPU may still write back over the incoming data
+    vPortDmaCacheInvalidate(rx_buf[rx_buf_switch], _rx_buf_size);
     uint8_t ret;
     ret = HAL_UARTEx_ReceiveToIdle_DMA(_huart, rx_buf[rx_buf_switch],
                                        _rx_buf_size);
@@ -188,6 +389,91 @@ status_t uart_drv_t::disable_rx_dma()
     return PYRO_OK;
 }
 
+/**
+ * @brief Switches between IDLE-chunk and circular ring reception.
+ *
+ * Reception is aborted and restarted in the new mode. Ring mode needs a ring,
+ * i.e. rx_ring_len in the UART table.
+ */
+status_t uart_drv_t::set_rx_mode(const rx_mode_t mode)
+{
+    if (rx_mode_ring == mode && nullptr == _rx_ring)
+    {
+        return PYRO_PARAM_ERROR;
+    }
+    HAL_UART_AbortReceive(_huart);
+    state.rx_dma_enable = 0;
+    _rx_mode            = mode;
+    return enable_rx_dma();
+}
+
+const uart_drv_t::rx_ring_stats_t &uart_drv_t::get_rx_ring_stats() const
+{
+    return _rx_ring_stats;
+}
+
+/**
+ * @brief Re-initialises the RX DMA stream if its mode differs.
+ *
+ * CubeMX sets up DMA_NORMAL and a DeInit/Init cycle in reset() restores it,
+ * so the mode is checked on every start.
+ */
+status_t uart_drv_t::set_dma_mode(const uint32_t mode)
+{
+    DMA_HandleTypeDef *hdma = _huart->hdmarx;
+    if (nullptr == hdma)
+    {
+        return PYRO_ERROR;
+    }
+    if (hdma->Init.Mode == mode)
+    {
+        return PYRO_OK;
+    }
+    hdma->Init.Mode = mode;
+    if (HAL_OK != HAL_DMA_Init(hdma))
+    {
+        return PYRO_ERROR;
+    }
+    return PYRO_OK;
+}
+
+/**
+ * @brief Starts the circular DMA over the whole ring.
+ *
+ * HT stays enabled so an event arrives at least every half ring even on a
+ * stream without gaps. Noise and framing errors leave the stream running and
+ * are ignored here; only a stopped receiver is restarted, with the tail back
+ * at the ring head.
+ */
+status_t uart_drv_t::start_rx_ring()
+{
+    if (HAL_UART_STATE_READY != _huart->RxState)
+    {
+        return PYRO_OK;
+    }
+    if (nullptr == _rx_ring || PYRO_OK != set_dma_mode(DMA_CIRCULAR))
+    {
+        return PYRO_ERROR;
+    }
+    if (state.rx_dma_enable)
+    {
+        // still marked running, so an overrun or reset() stopped it
+        _rx_ring_stats.restart_num++;
+    }
+    _rx_ring_tail = 0;
+    vPortDmaCacheInvalidate(_rx_ring, _rx_ring_len);
+    if (HAL_OK != HAL_UARTEx_ReceiveToIdle_DMA(_huart, _rx_ring, _rx_ring_len))
+    {
+        state.rx_dma_enable = 0;
+        state.rx_error      = 0x01U;
+        return PYRO_ERROR;
+    }
+    state.rx_dma_enable = 1;
+    state.rx_error      = 0;
+    state.rx_busy       = 0;
+    return PYRO_OK;
+}
+
 /* Peripheral Management -----------------------------------------------------*/
 /**
  * @brief Performs a full peripheral reset (DeInit -> Init).
@@ -222,33 +508,171 @@ status_t uart_drv_t::reset(uint32_t BaudRate, uint32_t WordLength,
 }
 
 /* Custom RX Event Callback Management ---------------------------------------*/
+// Writers copy the live table into the spare one, edit the copy and publish
+// it by flipping _rx_table_active. Readers are only the RX ISR, which runs to
+// completion before the writing task resumes on this single core, so the old
+// table is free again as soon as the flip is done. Suspending the scheduler
+// keeps writers apart without masking the UART interrupt.
+
+/**
+ * @brief Registers a custom RX event callback with an owner ID.
+ * @return PYRO_NO_MEMORY if all UART_RX_CB_NUM slots are taken.
+ */
+status_t uart_drv_t::add_rx_event_callback(const rx_event_func func,
+                                           void *ctx, const uint32_t owner)
+{
+    if (nullptr == func)
+    {
+        return PYRO_PARAM_ERROR;
+    }
+    return add_callback({owner, func, nullptr, ctx});
+}
+
+/**
+ * @brief Registers a ring mode span callback with an owner ID.
+ */
+status_t uart_drv_t::add_rx_span_callback(const rx_span_func func, void *ctx,
+                                          const uint32_t owner)
+{
+    if (nullptr == func)
+    {
+        return PYRO_PARAM_ERROR;
+    }
+    return add_callback({owner, nullptr, func, ctx});
+}
+
+status_t uart_drv_t::add_callback(const rx_event_callback_t &callback)
+{
+    status_t ret = PYRO_OK;
+    vTaskSuspendAll();
+    const uint8_t active   = _rx_table_active;
+    rx_event_table_t &next = _rx_tables[active ^ 0x01U];
+    next                   = _rx_tables[active];
+    uint8_t i              = 0;
+    while (i < next.num && next.callbacks[i].owner != callback.owner)
+    {
+        i++;
+    }
+    if (i == next.num && next.num >= UART_RX_CB_NUM)
+    {
+        ret = PYRO_NO_MEMORY;
+    }
+    else
+    {
+        next.callbacks[i] = callback;
+        if (i == next.num)
+        {
+            next.num++;
+        }
+        __DMB();
+        _rx_table_active = active ^ 0x01U;
+    }
+    xTaskResumeAll();
+    return ret;
+}
+
+/**
+ * @brief Removes a custom RX event callback based on the owner ID.
+ */
+status_t uart_drv_t::remove_rx_event_callback(const uint32_t owner)
+{
+    status_t ret = PYRO_NOT_FOUND;
+    vTaskSuspendAll();
+    const uint8_t active         = _rx_table_active;
+    const rx_event_table_t &live = _rx_tables[active];
+    rx_event_table_t &next       = _rx_tables[active ^ 0x01U];
+    next.num                     = 0;
+    for (uint8_t i = 0; i < live.num; i++)
+    {
+        if (live.callbacks[i].owner == owner)
+        {
+            ret = PYRO_OK;
+            continue;
+        }
+        next.callbacks[next.num++] = live.callbacks[i];
+    }
+    if (PYRO_OK == ret)
+    {
+        __DMB();
+        _rx_table_active = active ^ 0x01U;
+    }
+    xTaskResumeAll();
+    return ret;
+}
+
 /**
- * @brief Registers a custom C++ RX event callback with an owner ID.
+ * @brief Runs the published callbacks on the active RX buffer (ISR context).
+ *
+ * The first callback that consumes the data switches the buffer; reception
+ * is restarted either way. In ring mode size is the DMA write position and
+ * the stream keeps running.
  */
-void uart_drv_t::add_rx_event_callback(const rx_event_func &func,
-                                       uint32_t owner)
+void uart_drv_t::dispatch_rx_event(const uint16_t size, BaseType_t *woken)
 {
-    rx_event_callback_t callback;
-    callback.owner = owner;
-    callback.func  = func;
-    rx_event_callbacks.push_back(callback);
+    if (rx_mode_ring == _rx_mode)
+    {
+        dispatch_rx_ring(size, woken);
+        return;
+    }
+    vPortDmaCacheInvalidate(rx_buf[rx_buf_switch], size);
+    const rx_event_table_t &table = _rx_tables[_rx_table_active];
+    for (uint8_t i = 0; i < table.num; i++)
+    {
+        const rx_event_callback_t &cb = table.callbacks[i];
+        if (cb.func && cb.func(cb.ctx, rx_buf[rx_buf_switch], size, woken))
+        {
+            rx_buf_switch ^= 0x01U;
+            break;
+        }
+    }
+    enable_rx_dma();
 }
 
 /**
- * @brief Removes a custom C++ RX event callback based on the owner ID.
+ * @brief Hands out the bytes between the tail and the DMA write position.
+ *
+ * HAL reports the position as bytes from the ring head, ring_len on TC.
+ * Every span callback sees the same span.
  */
-status_t uart_drv_t::remove_rx_event_callback(uint32_t owner)
+void uart_drv_t::dispatch_rx_ring(uint16_t pos, BaseType_t *woken)
 {
-    for (auto it = rx_event_callbacks.begin(); it != rx_event_callbacks.end();
-         ++it)
+    if (pos >= _rx_ring_len)
+    {
+        pos = 0;
+    }
+    if (pos == _rx_ring_tail)
+    {
+        return;
+    }
+    rx_span_t span{};
+    span.data[0] = _rx_ring + _rx_ring_tail;
+    if (pos > _rx_ring_tail)
+    {
+        span.len[0] = pos - _rx_ring_tail;
+    }
+    else
     {
-        if (it->owner == owner)
+        span.len[0]  = _rx_ring_len - _rx_ring_tail;
+        span.data[1] = _rx_ring;
+        span.len[1]  = pos;
+        _rx_ring_stats.wrap_num++;
+    }
+    // stale lines from reading the previous span, incl. its partial last line
+    vPortDmaCacheInvalidate(_rx_ring + _rx_ring_tail, span.len[0]);
+    vPortDmaCacheInvalidate(_rx_ring, span.len[1]);
+    _rx_ring_tail = pos;
+    _rx_ring_stats.byte_num += span.len[0] + span.len[1];
+    _rx_ring_stats.event_num++;
+
+    const rx_event_table_t &table = _rx_tables[_rx_table_active];
+    for (uint8_t i = 0; i < table.num; i++)
+    {
+        const rx_event_callback_t &cb = table.callbacks[i];
+        if (cb.span_func)
         {
-            rx_event_callbacks.erase(it);
-            return PYRO_OK;
+            cb.span_func(cb.ctx, span, woken);
         }
     }
-    return PYRO_NOT_FOUND;
 }
 
 /* HAL Callback Registration -------------------------------------------------*/
@@ -316,44 +740,51 @@ status_t uart_drv_t::unregister_callback(const HAL_UART_CallbackIDTypeDef CB_ID)
 extern "C" void HAL_UARTEx_RxEventCallback(UART_HandleTypeDef *huart,
                                            uint16_t Size)
 {
-    const auto it = pyro::uart_drv_t::uart_map().find(huart);
-    static BaseType_t xHigherPriorityTaskWoken;
-    if (it != pyro::uart_drv_t::uart_map().end() && it->second)
+    BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+    pyro::uart_drv_t *drv               = pyro::uart_drv_t::find(huart);
+    if (drv)
     {
-        const auto drv = it->second;
-        for (auto &cb : drv->rx_event_callbacks)
-        {
-            if (cb.func(drv->rx_buf[drv->rx_buf_switch], Size,
-                        xHigherPriorityTaskWoken))
-            {
-                drv->rx_buf_switch ^= 0x01U;
-                break;
-            }
-        }
-        drv->enable_rx_dma();
+        drv->dispatch_rx_event(Size, &xHigherPriorityTaskWoken);
     }
+    portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
+}
 
-    if (xHigherPriorityTaskWoken)
+/**
+ * @brief HAL UART TX Complete Callback, chains the next queued transfer.
+ */
+extern "C" void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart)
+{
+    BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+    pyro::uart_drv_t *drv               = pyro::uart_drv_t::find(huart);
+    if (drv)
     {
-        portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
+        drv->handle_tx_cplt(&xHigherPriorityTaskWoken);
     }
+    portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
 }
 
 /**
  * @brief HAL UART Error Callback.
  *
  * This ISR-context function clears all pending error flags (Parity, Framing,
- * Overrun, etc.) and restarts DMA reception to recover the peripheral.
+ * Overrun, etc.) and restarts DMA reception to recover the peripheral. A TX
+ * DMA error leaves gState ready without a TX complete, so the queued
+ * transfer is retired here.
  */
 extern "C" void HAL_UART_ErrorCallback(UART_HandleTypeDef *huart)
 {
-    const auto it = pyro::uart_drv_t::uart_map().find(huart);
-    if (it != pyro::uart_drv_t::uart_map().end() && it->second)
+    BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+    pyro::uart_drv_t *drv               = pyro::uart_drv_t::find(huart);
+    if (drv)
     {
-        const auto drv = it->second;
         __HAL_UART_CLEAR_FLAG(huart, UART_CLEAR_PEF | UART_CLEAR_FEF |
                                          UART_CLEAR_NEF | UART_CLEAR_OREF |
                                          UART_CLEAR_RTOF);
         drv->enable_rx_dma();
+        if (HAL_UART_STATE_READY == huart->gState)
+        {
+            drv->handle_tx_cplt(&xHigherPriorityTaskWoken, true);
+        }
     }
-}
\ No newline at end of file
+    portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
+}
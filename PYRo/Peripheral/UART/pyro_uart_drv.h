@@ -4,7 +4,13 @@
  *
  * This file defines the `pyro::uart_drv_t` class, which encapsulates the
  * STM32 HAL UART functionality, including DMA double-buffering for reception
- * and integration with FreeRTOS for asynchronous event handling.
+ * and integration with FreeRTOS for asynchronous event handling. One driver
+ * per row of pyro_uart_table.h is created statically, with its buffers in
+ * the .dma_buffer section.
+ *
+ * RX event callbacks live in a fixed-size table per driver. Tasks edit a
+ * copy and publish it by flipping an index, so the ISR walks a table that
+ * never changes under it and never touches the heap.
  *
  * @author Lucky
  * @version 1.0.0
@@ -19,15 +25,13 @@
 #include "stm32h7xx_hal.h"
 #include "stm32h7xx_hal_uart.h"
 
+#include "pyro_core_config.h"
 #include "pyro_core_def.h"
+#include "pyro_core_dma_heap.h"
 
 #include "FreeRTOS.h"
 #include "message_buffer.h"
 
-#include "functional"
-#include "map"
-#include "vector"
-
 namespace pyro
 {
 enum which_uart
@@ -41,28 +45,129 @@ class uart_drv_t;
  * @brief C++ class to encapsulate the STM32 HAL UART driver functionality.
  *
  * It manages double-buffering for DMA reception, integrates with FreeRTOS
- * for yielding from ISRs, and uses a static map to dispatch HAL callbacks
- * to the correct C++ instance.
+ * for yielding from ISRs, and uses the UART table to dispatch HAL
+ * callbacks to the correct C++ instance.
  */
 class uart_drv_t
 {
+  public:
+    /* Public Types ----------------------------------------------------------*/
+    /**
+     * @brief Reception strategy, see set_rx_mode().
+     *
+     * idle: one DMA transfer per IDLE-delimited chunk into the double buffers,
+     * re-armed after every event. ring: a circular DMA that is never stopped;
+     * HT, TC and IDLE events hand out the bytes written since the last event.
+     */
+    enum rx_mode_t
+    {
+        rx_mode_idle,
+        rx_mode_ring
+    };
+
+    /**
+     * @brief Bytes received in ring mode, split in two where they wrap the
+     * ring end (len[1] is 0 otherwise). Valid until the DMA comes round
+     * again, ring_len bytes later.
+     */
+    typedef struct rx_span_t
+    {
+        const uint8_t *data[2];
+        uint16_t len[2];
+    } rx_span_t;
+
+    typedef struct rx_ring_stats_t
+    {
+        uint32_t byte_num;
+        uint32_t event_num;
+        uint32_t wrap_num;
+        uint32_t restart_num; // stream restarted after an overrun or reset()
+    } rx_ring_stats_t;
+
+    /**
+     * @brief TX completion callback. data is the buffer given to
+     * write_ref(), which the caller owns again from here on.
+     *
+     * Normally runs in the TX complete interrupt. A transfer that fails to
+     * start is retired from the task that called write() / write_ref(),
+     * with woken == nullptr. Never called with interrupts masked.
+     */
+    using tx_done_func = void (*)(void *ctx, const uint8_t *data,
+                                  BaseType_t *woken);
+
+    typedef struct tx_stats_t
+    {
+        uint32_t frame_num; // transfers completed
+        uint32_t byte_num;
+        uint32_t full_num;  // writes refused, queue or copy ring full
+        uint32_t error_num; // transfers that failed to start or aborted
+        uint8_t queue_max;  // most descriptors queued at once
+    } tx_stats_t;
+
+  private:
     /* Private Types ---------------------------------------------------------*/
     /**
      * @brief Type alias for the RX event callback signature (for ISR context).
+     *
+     * ctx is the pointer given at registration. FromISR calls report through
+     * woken; the dispatcher yields once after all callbacks have run.
      * @return true if the data was consumed and the RX buffer should switch.
      */
-    using rx_event_func = std::function<bool(
-        uint8_t *p, uint16_t size, BaseType_t xHigherPriorityTaskWoken)>;
+    using rx_event_func = bool (*)(void *ctx, uint8_t *p, uint16_t size,
+                                   BaseType_t *woken);
+    /**
+     * @brief Ring mode callback (ISR context), called once per event.
+     */
+    using rx_span_func = void (*)(void *ctx, const rx_span_t &span,
+                                  BaseType_t *woken);
 
     /**
      * @brief Structure to store registered RX callbacks with an owner ID.
+     *
+     * Exactly one of func / span_func is set; each runs in its own mode only.
      */
     typedef struct rx_event_callback_t
     {
         uint32_t owner;
         rx_event_func func;
+        rx_span_func span_func;
+        void *ctx;
     } rx_event_callback_t;
 
+    /**
+     * @brief One published version of the callback list.
+     */
+    typedef struct rx_event_table_t
+    {
+        rx_event_callback_t callbacks[UART_RX_CB_NUM];
+        uint8_t num;
+    } rx_event_table_t;
+
+    /**
+     * @brief One queued DMA transfer. Copies point into _tx_buf; write_ref()
+     * frames point at the caller's buffer.
+     */
+    typedef struct tx_desc_t
+    {
+        const uint8_t *data;
+        uint16_t len;
+        volatile bool ready;  // data in place, may be started
+        uint32_t buf_release; // _tx_buf_tail once this transfer is done
+        tx_done_func done;
+        void *ctx;
+    } tx_desc_t;
+
+    /**
+     * @brief done call of a retired descriptor, made once interrupts are
+     * unmasked again.
+     */
+    typedef struct tx_done_t
+    {
+        tx_done_func done;
+        void *ctx;
+        const uint8_t *data;
+    } tx_done_t;
+
     /**
      * @brief Internal state flags (bit-field) for tracking driver status.
      */
@@ -77,11 +182,49 @@ class uart_drv_t
     } state_t;
 
   public:
+    /**
+     * @brief One row of the UART table, see pyro_uart_table.h.
+     */
+    typedef struct desc_t
+    {
+        UART_HandleTypeDef *huart;
+        which_uart which;     // must equal the row index
+        uint16_t rx_buf_len;  // each of the two idle mode buffers
+        uint16_t rx_ring_len; // 0 if the uart never runs in ring mode
+        rx_mode_t rx_mode;    // mode reception starts in
+    } desc_t;
+
+    static constexpr uint32_t dma_lines(uint32_t len)
+    {
+        return (len + DMA_CACHE_LINE_SIZE - 1) & ~(DMA_CACHE_LINE_SIZE - 1);
+    }
+
+    // DMA RAM of one uart: both rx buffers, the ring and the tx copy ring,
+    // each rounded to whole cache lines
+    static constexpr uint32_t dma_size(const desc_t &desc)
+    {
+        return 2 * dma_lines(desc.rx_buf_len) + dma_lines(desc.rx_ring_len) +
+               dma_lines(UART_TX_BUF_LEN);
+    }
 
     /* Public Methods - Initialization and De-initialization
      * -------------------*/
-    explicit uart_drv_t(UART_HandleTypeDef *huart, uint16_t buf_length);
-    ~uart_drv_t();
+    // Only used for the static table; dma is dma_size(desc) bytes of
+    // cache line aligned DMA RAM
+    constexpr uart_drv_t(const desc_t &desc, uint8_t *dma)
+        : rx_buf{dma, dma + dma_lines(desc.rx_buf_len)},
+          state{1, 0, 0, 0, 0, 0}, _huart(desc.huart),
+          _rx_buf_size(desc.rx_buf_len), _rx_mode(desc.rx_mode),
+          _rx_ring(desc.rx_ring_len ? dma + 2 * dma_lines(desc.rx_buf_len)
+                                    : nullptr),
+          _rx_ring_len(desc.rx_ring_len),
+          _tx_buf(dma + 2 * dma_lines(desc.rx_buf_len) +
+                  dma_lines(desc.rx_ring_len)),
+          _index(static_cast<int8_t>(desc.which))
+    {
+    }
+    uart_drv_t(const uart_drv_t &)            = delete;
+    uart_drv_t &operator=(const uart_drv_t &) = delete;
     status_t reset(uint32_t BaudRate, uint32_t WordLength, uint32_t StopBits,
                    uint32_t Parity);
     static uart_drv_t *get_instance(which_uart uart);
@@ -90,17 +233,31 @@ class uart_drv_t
      * -------------------------------------------*/
     status_t write(const uint8_t *p, uint16_t size,
                    uint32_t waittime);               // Polling
-    status_t write(const uint8_t *p, uint16_t size); // DMA
+    status_t write(const uint8_t *p, uint16_t size); // DMA, copied
+    // DMA without a copy; p must stay valid until done runs
+    status_t write_ref(const uint8_t *p, uint16_t size, tx_done_func done,
+                       void *ctx);
+    void handle_tx_cplt(BaseType_t *woken, bool failed = false); // ISR
+    const tx_stats_t &get_tx_stats() const;
 
     /* Public Methods - Reception Control
      * --------------------------------------*/
     status_t enable_rx_dma();
     status_t disable_rx_dma();
+    // Restarts reception in the given mode; ring mode needs rx_ring_len
+    status_t set_rx_mode(rx_mode_t mode);
+    const rx_ring_stats_t &get_rx_ring_stats() const;
 
     /* Public Methods - Custom Callback Management
      * -----------------------------*/
-    void add_rx_event_callback(const rx_event_func &func, uint32_t owner);
-    status_t remove_rx_event_callback(uint32_t);
+    // Task context only. An owner added again replaces its old entry.
+    status_t add_rx_event_callback(rx_event_func func, void *ctx,
+                                   uint32_t owner);
+    status_t add_rx_span_callback(rx_span_func func, void *ctx,
+                                  uint32_t owner);
+    status_t remove_rx_event_callback(uint32_t owner);
+    void dispatch_rx_event(uint16_t size, BaseType_t *woken); // ISR
+    static uart_drv_t *find(const UART_HandleTypeDef *huart);
 
     /* Public Methods - HAL Callback Registration
      * ------------------------------*/
@@ -112,18 +269,51 @@ class uart_drv_t
 
     /* Public Members - Internal State/Data
      * ------------------------------------*/
-    std::vector<rx_event_callback_t> rx_event_callbacks;
-    static std::map<UART_HandleTypeDef *, uart_drv_t *> &uart_map();
     uint8_t *rx_buf[2];      // Double buffers for DMA reception
     uint8_t rx_buf_switch{}; // Index of the currently active buffer
     state_t state{};
 
 
   private:
+    /* Private Methods
+     * ---------------------------------------------------------*/
+    status_t add_callback(const rx_event_callback_t &callback);
+    status_t set_dma_mode(uint32_t mode);
+    status_t start_rx_ring();
+    void dispatch_rx_ring(uint16_t pos, BaseType_t *woken);
+    tx_desc_t *tx_reserve(uint16_t size, uint8_t **copy_to);
+    void tx_submit(tx_desc_t *desc);
+    void tx_kick(tx_done_t *failed, uint8_t &failed_num);
+    static void tx_notify(const tx_done_t *list, uint8_t num,
+                          BaseType_t *woken);
+
     /* Private Members
      * ---------------------------------------------------------*/
     UART_HandleTypeDef *_huart; // HAL handle for the peripheral
     uint16_t _rx_buf_size{};    // Size of each RX buffer
+
+    rx_mode_t _rx_mode{rx_mode_idle};
+    uint8_t *_rx_ring{};      // circular DMA target, DMA RAM
+    uint16_t _rx_ring_len{};
+    uint16_t _rx_ring_tail{}; // first byte not yet handed out
+    rx_ring_stats_t _rx_ring_stats{};
+
+    // Producers (tasks) reserve and fill descriptors in order; the TX
+    // complete interrupt starts the next ready one. Both sides run with
+    // interrupts masked while touching the indices.
+    uint8_t *_tx_buf{};       // copy ring, UART_TX_BUF_LEN bytes, DMA RAM
+    uint32_t _tx_buf_head{};  // free running byte counters
+    uint32_t _tx_buf_tail{};
+    tx_desc_t _tx_desc[UART_TX_DESC_NUM]{};
+    uint32_t _tx_desc_head{};
+    uint32_t _tx_desc_tail{};
+    volatile bool _tx_active{};
+    tx_stats_t _tx_stats{};
+
+    // The ISR reads _rx_tables[_rx_table_active]; writers fill the other one
+    rx_event_table_t _rx_tables[2]{};
+    volatile uint8_t _rx_table_active{};
+    int8_t _index{-1}; // row in the uart table
 };
 
 } // namespace pyro
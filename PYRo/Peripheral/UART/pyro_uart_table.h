@@ -0,0 +1,28 @@
+/**
+ * @file pyro_uart_table.h
+ * @brief UART instances of this board, one driver per row.
+ *
+ * Add a row and a which_uart entry for a new UART (mini-PC, referee system);
+ * the driver and its DMA buffers are created from the row. Rows must stay in
+ * which_uart order.
+ */
+
+#ifndef __PYRO_UART_TABLE_H__
+#define __PYRO_UART_TABLE_H__
+
+/* Includes ------------------------------------------------------------------*/
+#include "pyro_uart_drv.h"
+#include "usart.h"
+
+namespace pyro
+{
+// rx_ring_len 0 keeps set_rx_mode(rx_mode_ring) off a uart. The vofa link
+// may carry a byte stream, so it has a ring; dr16 frames are idle-delimited.
+static constexpr uart_drv_t::desc_t uart_desc_table[] = {
+    // huart   which  rx_buf_len rx_ring_len rx_mode
+    {&huart1, uart1, 42, 256, uart_drv_t::rx_mode_idle}, // vofa
+    {&huart5, uart5, 36, 0, uart_drv_t::rx_mode_idle},   // dr16
+};
+} // namespace pyro
+
+#endif
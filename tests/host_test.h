@@ -0,0 +1,43 @@
+#ifndef HOST_TEST_H
+#define HOST_TEST_H
+
+#include <chrono>
+#include <cstdio>
+
+// Minimal checks for the host tests: a failed CHECK is printed and counted,
+// main returns host_test::result() so ctest sees the failure.
+namespace host_test
+{
+inline int &fail_num()
+{
+    static int num = 0;
+    return num;
+}
+
+inline int result()
+{
+    if (fail_num())
+        std::printf("%d check(s) failed\n", fail_num());
+    return fail_num() ? 1 : 0;
+}
+
+inline double now_ns()
+{
+    return std::chrono::duration<double, std::nano>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+} // namespace host_test
+
+#define CHECK(expr)                                                            \
+    do                                                                         \
+    {                                                                          \
+        if (!(expr))                                                           \
+        {                                                                      \
+            std::printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__,       \
+                        #expr);                                                \
+            host_test::fail_num()++;                                           \
+        }                                                                      \
+    } while (0)
+
+#endif
@@ -0,0 +1,235 @@
+#include "host_test.h"
+#include "pyro_can_filter.h"
+
+#include <algorithm>
+#include <random>
+#include <set>
+#include <vector>
+
+using pyro::can_filter_elem_t;
+using pyro::CAN_FILTER_PACK_MAX;
+
+// Filter packing against a software model of the FDCAN filter elements: every
+// registered id must pass, and with room for an exact cover nothing else may.
+namespace
+{
+bool accepts(const can_filter_elem_t &elem, uint32_t id)
+{
+    switch (elem.type)
+    {
+    case pyro::can_filter_range:
+        return elem.id1 <= id && id <= elem.id2;
+    case pyro::can_filter_dual:
+        return id == elem.id1 || id == elem.id2;
+    case pyro::can_filter_mask:
+        return (id & elem.id2) == elem.id1;
+    }
+    return false;
+}
+
+bool accepts(const can_filter_elem_t *elems, uint8_t elem_num, uint32_t id)
+{
+    for (uint8_t i = 0; i < elem_num; i++)
+    {
+        if (accepts(elems[i], id))
+            return true;
+    }
+    return false;
+}
+
+// Runs longer than one id take an element each, single ids go in pairs
+uint8_t exact_num(const std::vector<uint32_t> &ids)
+{
+    uint8_t runs = 0, singles = 0;
+    for (size_t i = 0; i < ids.size();)
+    {
+        size_t j = i;
+        while (j + 1 < ids.size() && ids[j + 1] == ids[j] + 1)
+            j++;
+        if (j == i)
+            singles++;
+        else
+            runs++;
+        i = j + 1;
+    }
+    return runs + (singles + 1) / 2;
+}
+
+std::vector<uint32_t> random_ids(std::mt19937 &rng, uint8_t num,
+                                 uint32_t id_max)
+{
+    std::set<uint32_t> set;
+    std::uniform_int_distribution<uint32_t> id(0, id_max);
+    std::uniform_int_distribution<uint32_t> run(1, 4);
+    while (set.size() < num)
+    {
+        // Mix of singles and short runs, like motor feedback ids
+        uint32_t first = id(rng);
+        uint32_t len   = run(rng);
+        for (uint32_t k = 0; k < len && set.size() < num; k++)
+        {
+            if (first + k <= id_max)
+                set.insert(first + k);
+        }
+    }
+    return std::vector<uint32_t>(set.begin(), set.end());
+}
+
+void test_basic()
+{
+    can_filter_elem_t elems[CAN_FILTER_PACK_MAX];
+    uint32_t extra = 1;
+
+    CHECK(0 == pyro::can_filter_pack(nullptr, 0, 11, elems, 4, &extra));
+    CHECK(0 == extra);
+
+    uint32_t run[] = {0x201, 0x202, 0x203, 0x204};
+    CHECK(1 == pyro::can_filter_pack(run, 4, 11, elems, 4, &extra));
+    CHECK(pyro::can_filter_range == elems[0].type);
+    CHECK(0x201 == elems[0].id1 && 0x204 == elems[0].id2);
+    CHECK(0 == extra);
+
+    uint32_t singles[] = {0x101, 0x105, 0x109, 0x10D, 0x111};
+    uint8_t num = pyro::can_filter_pack(singles, 5, 11, elems, 8, &extra);
+    CHECK(3 == num);
+    for (uint8_t i = 0; i < num; i++)
+        CHECK(pyro::can_filter_dual == elems[i].type);
+    for (uint32_t id : singles)
+        CHECK(accepts(elems, num, id));
+    CHECK(0 == extra);
+
+    // Too many ids for one call
+    uint32_t many[CAN_FILTER_PACK_MAX + 1];
+    for (uint32_t i = 0; i <= CAN_FILTER_PACK_MAX; i++)
+        many[i] = 2 * i;
+    CHECK(0 == pyro::can_filter_pack(many, CAN_FILTER_PACK_MAX + 1, 11,
+                                     elems, CAN_FILTER_PACK_MAX, &extra));
+}
+
+// With room for it, the cover is exact and as small as it can be
+void test_exact_std(std::mt19937 &rng)
+{
+    std::uniform_int_distribution<uint32_t> size(1, CAN_FILTER_PACK_MAX);
+    uint32_t bad = 0;
+    for (int round = 0; round < 2000; round++)
+    {
+        std::vector<uint32_t> ids = random_ids(rng, size(rng), 0x7FF);
+        can_filter_elem_t elems[CAN_FILTER_PACK_MAX];
+        uint32_t extra = 1;
+        uint8_t num    = pyro::can_filter_pack(
+            ids.data(), ids.size(), 11, elems, CAN_FILTER_PACK_MAX, &extra);
+
+        bool ok = num == exact_num(ids) && 0 == extra;
+        for (uint32_t id = 0; ok && id <= 0x7FF; id++)
+        {
+            bool want = std::binary_search(ids.begin(), ids.end(), id);
+            ok        = want == accepts(elems, num, id);
+        }
+        if (!ok)
+            bad++;
+    }
+    CHECK(0 == bad);
+}
+
+// Short of elements every registered id still passes, within the budget,
+// and the reported extra bounds what actually gets through
+void test_tight_std(std::mt19937 &rng)
+{
+    uint32_t bad = 0, merged = 0;
+    for (int round = 0; round < 2000; round++)
+    {
+        std::uniform_int_distribution<uint32_t> size(3, CAN_FILTER_PACK_MAX);
+        std::vector<uint32_t> ids = random_ids(rng, size(rng), 0x7FF);
+        uint8_t need              = exact_num(ids);
+        if (need < 2)
+            continue;
+        std::uniform_int_distribution<uint32_t> room(1, need - 1);
+        uint8_t elem_max = room(rng);
+
+        can_filter_elem_t elems[CAN_FILTER_PACK_MAX];
+        uint32_t extra = 0;
+        uint8_t num    = pyro::can_filter_pack(ids.data(), ids.size(), 11,
+                                               elems, elem_max, &extra);
+
+        uint32_t leak = 0;
+        bool ok       = num > 0 && num <= elem_max;
+        for (uint32_t id = 0; id <= 0x7FF; id++)
+        {
+            bool want = std::binary_search(ids.begin(), ids.end(), id);
+            bool got  = accepts(elems, num, id);
+            if (want && !got)
+                ok = false;
+            if (!want && got)
+                leak++;
+        }
+        if (!ok || leak > extra)
+            bad++;
+        merged++;
+    }
+    CHECK(merged > 0);
+    CHECK(0 == bad);
+}
+
+// Extended ids: too wide to enumerate, so check the registered ids, their
+// neighbours and a random sample
+void test_ext(std::mt19937 &rng)
+{
+    constexpr uint32_t ID_MAX = 0x1FFFFFFF;
+    std::uniform_int_distribution<uint32_t> sample(0, ID_MAX);
+    uint32_t bad = 0;
+    for (int round = 0; round < 2000; round++)
+    {
+        std::uniform_int_distribution<uint32_t> size(1, CAN_RX_EXT_ID_MAX_NUM);
+        std::vector<uint32_t> ids = random_ids(rng, size(rng), ID_MAX);
+        uint8_t need              = exact_num(ids);
+        std::uniform_int_distribution<uint32_t> room(1, need);
+        uint8_t elem_max = room(rng);
+
+        can_filter_elem_t elems[CAN_FILTER_PACK_MAX];
+        uint32_t extra = 0;
+        uint8_t num    = pyro::can_filter_pack(ids.data(), ids.size(), 29,
+                                               elems, elem_max, &extra);
+
+        bool ok = num > 0 && num <= elem_max;
+        for (uint32_t id : ids)
+            ok = ok && accepts(elems, num, id);
+        for (uint8_t i = 0; ok && i < num; i++)
+        {
+            if (pyro::can_filter_mask == elems[i].type)
+                ok = elems[i].id2 <= ID_MAX;
+        }
+        if (ok && elem_max == need)
+        {
+            ok = 0 == extra && num == need;
+            std::vector<uint32_t> probe;
+            for (uint32_t id : ids)
+            {
+                probe.push_back(id - 1);
+                probe.push_back(id + 1);
+            }
+            for (int k = 0; k < 256; k++)
+                probe.push_back(sample(rng));
+            for (uint32_t id : probe)
+            {
+                if (id <= ID_MAX &&
+                    !std::binary_search(ids.begin(), ids.end(), id) &&
+                    accepts(elems, num, id))
+                    ok = false;
+            }
+        }
+        if (!ok)
+            bad++;
+    }
+    CHECK(0 == bad);
+}
+} // namespace
+
+int main()
+{
+    std::mt19937 rng(20240611);
+    test_basic();
+    test_exact_std(rng);
+    test_tight_std(rng);
+    test_ext(rng);
+    return host_test::result();
+}
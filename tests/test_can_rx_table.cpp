@@ -0,0 +1,196 @@
+#include "host_test.h"
+#include "map.h"
+#include "pyro_can_rx_table.h"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+// Lookup of the CAN rx path (can_drv_t::handle_rx_msg) against the number of
+// registered ids, next to the map_t scan it replaced. The table must find
+// every registered id and nothing else, and its cost must not grow with the
+// number of ids.
+namespace
+{
+typedef struct msg_t
+{
+    uint32_t id;
+    uint32_t hit_num;
+} msg_t;
+
+typedef pyro::can_rx_table_t<msg_t> table_t;
+
+constexpr uint32_t STREAM_LEN = 4096;
+constexpr uint32_t ROUND_NUM  = 200;
+
+std::vector<uint32_t> pick_ids(std::mt19937 &rng, uint32_t num,
+                               uint32_t id_max)
+{
+    std::vector<uint32_t> ids;
+    std::uniform_int_distribution<uint32_t> id(0, id_max);
+    while (ids.size() < num)
+    {
+        uint32_t v = id(rng);
+        if (std::find(ids.begin(), ids.end(), v) == ids.end())
+            ids.push_back(v);
+    }
+    return ids;
+}
+
+// Received ids in random order, one in eight nobody registered
+std::vector<uint32_t> make_stream(std::mt19937 &rng,
+                                  const std::vector<uint32_t> &ids,
+                                  uint32_t id_max)
+{
+    std::vector<uint32_t> stream;
+    std::uniform_int_distribution<uint32_t> any(0, id_max);
+    for (uint32_t i = 0; i < STREAM_LEN; i++)
+        stream.push_back(rng() % 8 ? ids[rng() % ids.size()] : any(rng));
+    return stream;
+}
+
+// Best of a few runs, so a preempted run does not count
+template <typename Find>
+double time_lookup(const std::vector<uint32_t> &stream, Find find)
+{
+    double best = 0;
+    for (int run = 0; run < 5; run++)
+    {
+        double start = host_test::now_ns();
+        for (uint32_t r = 0; r < ROUND_NUM; r++)
+        {
+            for (uint32_t id : stream)
+            {
+                msg_t *msg = find(id);
+                if (msg)
+                    msg->hit_num++;
+            }
+        }
+        double ns = (host_test::now_ns() - start) / (ROUND_NUM * STREAM_LEN);
+        if (0 == run || ns < best)
+            best = ns;
+    }
+    return best;
+}
+
+void test_table(std::mt19937 &rng)
+{
+    static table_t::slot_t slots[table_t::STD_ID_NUM];
+    static msg_t msgs[CAN_RX_ID_MAX_NUM + CAN_RX_EXT_ID_MAX_NUM + 1];
+    table_t table;
+    uint32_t ids[CAN_RX_ID_MAX_NUM];
+
+    CHECK(pyro::PYRO_PARAM_ERROR == table.add(0x201, false, &msgs[0]));
+    CHECK(nullptr == table.find(0x201, false));
+    table.attach(slots);
+    CHECK(pyro::PYRO_PARAM_ERROR == table.add(0x800, false, &msgs[0]));
+
+    std::vector<uint32_t> std_ids = pick_ids(rng, CAN_RX_ID_MAX_NUM, 0x7FF);
+    std::vector<uint32_t> ext_ids =
+        pick_ids(rng, CAN_RX_EXT_ID_MAX_NUM, 0x1FFFFFFF);
+    for (uint32_t i = 0; i < std_ids.size(); i++)
+        CHECK(pyro::PYRO_OK == table.add(std_ids[i], false, &msgs[i]));
+    for (uint32_t i = 0; i < ext_ids.size(); i++)
+    {
+        CHECK(pyro::PYRO_OK ==
+              table.add(ext_ids[i], true, &msgs[CAN_RX_ID_MAX_NUM + i]));
+    }
+    CHECK(pyro::PYRO_NO_MEMORY == table.add(0x7FF, false, &msgs[0]));
+    CHECK(pyro::PYRO_NO_MEMORY == table.add(0x1FFFFFFF, true, &msgs[0]));
+
+    uint32_t bad = 0;
+    for (uint32_t id = 0; id < table_t::STD_ID_NUM; id++)
+    {
+        auto it     = std::find(std_ids.begin(), std_ids.end(), id);
+        msg_t *want = it == std_ids.end() ? nullptr
+                                          : &msgs[it - std_ids.begin()];
+        if (table.find_std(id) != want || table.find(id, false) != want)
+            bad++;
+    }
+    for (uint32_t i = 0; i < ext_ids.size(); i++)
+    {
+        uint32_t next = ext_ids[i] + 1;
+        bool next_reg =
+            std::find(ext_ids.begin(), ext_ids.end(), next) != ext_ids.end();
+        if (table.find_ext(ext_ids[i]) != &msgs[CAN_RX_ID_MAX_NUM + i] ||
+            (!next_reg && table.find_ext(next)))
+            bad++;
+    }
+    // A standard and an extended id with the same number are different ids
+    if (table.find(std_ids[0], true) &&
+        std::find(ext_ids.begin(), ext_ids.end(), std_ids[0]) ==
+            ext_ids.end())
+        bad++;
+    CHECK(0 == bad);
+
+    std::sort(std_ids.begin(), std_ids.end());
+    std::sort(ext_ids.begin(), ext_ids.end());
+    CHECK(std_ids.size() == table.std_ids(ids) &&
+          std::equal(std_ids.begin(), std_ids.end(), ids));
+    CHECK(ext_ids.size() == table.ext_ids(ids) &&
+          std::equal(ext_ids.begin(), ext_ids.end(), ids));
+}
+
+void bench(std::mt19937 &rng)
+{
+    static table_t::slot_t slots[table_t::STD_ID_NUM];
+    static msg_t msgs[CAN_RX_ID_MAX_NUM];
+    double std_first = 0, std_last = 0;
+
+    std::printf("ids  std ns/frame  ext ns/frame  map_t ns/frame\n");
+    for (uint32_t num = 1; num <= CAN_RX_ID_MAX_NUM; num++)
+    {
+        table_t table;
+        table.attach(slots);
+        pyro::map_t<uint32_t, msg_t *> map;
+        map.clear(); // map_t leaves its size uninitialised
+        uint32_t ext_num = std::min<uint32_t>(num, CAN_RX_EXT_ID_MAX_NUM);
+
+        std::vector<uint32_t> std_ids = pick_ids(rng, num, 0x7FF);
+        std::vector<uint32_t> ext_ids = pick_ids(rng, ext_num, 0x1FFFFFFF);
+        for (uint32_t i = 0; i < num; i++)
+        {
+            table.add(std_ids[i], false, &msgs[i]);
+            if (num <= map._max_size)
+                map[std_ids[i]] = &msgs[i];
+        }
+        for (uint32_t i = 0; i < ext_num; i++)
+            table.add(ext_ids[i], true, &msgs[i]);
+
+        std::vector<uint32_t> std_stream = make_stream(rng, std_ids, 0x7FF);
+        std::vector<uint32_t> ext_stream =
+            make_stream(rng, ext_ids, 0x1FFFFFFF);
+        double std_ns = time_lookup(
+            std_stream, [&](uint32_t id) { return table.find_std(id); });
+        double ext_ns = time_lookup(
+            ext_stream, [&](uint32_t id) { return table.find_ext(id); });
+        if (1 == num)
+            std_first = std_ns;
+        std_last = std_ns;
+
+        if (num <= map._max_size)
+        {
+            // The old handle_rx_msg: exist(), then operator[] scans again
+            double map_ns = time_lookup(std_stream, [&](uint32_t id) {
+                return map.exist(id) ? map[id] : nullptr;
+            });
+            std::printf("%3u  %12.2f  %12.2f  %14.2f\n", num, std_ns, ext_ns,
+                        map_ns);
+        }
+        else
+            std::printf("%3u  %12.2f  %12.2f  %14s\n", num, std_ns, ext_ns,
+                        "full");
+    }
+
+    // Loose bound, the point is no growth with the id count
+    CHECK(std_last < 3 * std_first + 1);
+}
+} // namespace
+
+int main()
+{
+    std::mt19937 rng(0x201);
+    test_table(rng);
+    bench(rng);
+    return host_test::result();
+}
@@ -0,0 +1,307 @@
+#include "frame_parser.h"
+#include "host_test.h"
+
+#include <memory>
+#include <random>
+#include <vector>
+
+// Fuzz test of frame_parser_t on a referee layout stream. Valid frames are
+// mixed with noise, stray SOFs, broken headers, broken bodies and oversize
+// headers, then fed in random chunks; every valid frame must come out once,
+// in order, and each kind of damage must land in its own counter.
+namespace
+{
+constexpr uint16_t MAX_FRAME = 128;
+constexpr uint8_t SOF        = 0xA5;
+constexpr uint16_t LEN_MAX   = MAX_FRAME - 9;
+
+typedef pyro::frame_parser_t<MAX_FRAME, 512> parser_t;
+typedef std::vector<uint8_t> bytes_t;
+
+typedef struct stream_t
+{
+    bytes_t data;
+    std::vector<bytes_t> frames; // the valid ones, in order
+    uint32_t head_err_num;
+    uint32_t crc_err_num;
+    uint32_t oversize_num;
+} stream_t;
+
+// Any byte but SOF, so the parser never locks onto it while hunting
+uint8_t not_sof(std::mt19937 &rng)
+{
+    uint8_t b = static_cast<uint8_t>(rng());
+    return SOF == b ? 0x5A : b;
+}
+
+void put_head(bytes_t &out, uint16_t len, uint8_t seq)
+{
+    size_t at = out.size();
+    out.push_back(SOF);
+    out.push_back(len & 0xFF);
+    out.push_back(len >> 8);
+    out.push_back(seq);
+    out.push_back(pyro::crc8(&out[at], 4));
+}
+
+bytes_t make_frame(std::mt19937 &rng, uint16_t len)
+{
+    bytes_t frame;
+    put_head(frame, len, static_cast<uint8_t>(rng()));
+    for (uint16_t i = 0; i < 2 + len; i++) // cmd id, payload
+        frame.push_back(static_cast<uint8_t>(rng()));
+    uint16_t crc = pyro::crc16(frame.data(), frame.size());
+    frame.push_back(crc & 0xFF);
+    frame.push_back(crc >> 8);
+    return frame;
+}
+
+stream_t make_stream(std::mt19937 &rng, uint32_t event_num)
+{
+    stream_t s{};
+    std::uniform_int_distribution<uint16_t> len(0, LEN_MAX);
+    for (uint32_t e = 0; e < event_num; e++)
+    {
+        switch (rng() % 9)
+        {
+        case 0: // noise
+            for (uint32_t i = rng() % 16; i; i--)
+                s.data.push_back(not_sof(rng));
+            break;
+        case 1: // header crc8 broken, nothing after SOF looks like a SOF
+        {
+            uint8_t head[5] = {SOF, not_sof(rng), not_sof(rng), not_sof(rng)};
+            head[4] = pyro::crc8(head, 4) + 1;
+            if (SOF == head[4])
+                head[4]++;
+            s.data.insert(s.data.end(), head, head + 5);
+            s.head_err_num++;
+            break;
+        }
+        case 2: // good header, damaged payload or crc16
+        {
+            bytes_t frame = make_frame(rng, len(rng));
+            frame[5 + rng() % (frame.size() - 5)] ^= 1 << (rng() % 8);
+            s.data.insert(s.data.end(), frame.begin(), frame.end());
+            s.crc_err_num++;
+            break;
+        }
+        case 3: // valid header claiming more than a slot holds
+        {
+            uint16_t big = LEN_MAX + 1 + rng() % 64;
+            if (SOF == (big & 0xFF))
+                big++;
+            uint8_t seq = 0;
+            bytes_t head;
+            do
+            {
+                head.clear();
+                put_head(head, big, seq++);
+            } while (SOF == head[3] || SOF == head[4]);
+            s.data.insert(s.data.end(), head.begin(), head.end());
+            s.oversize_num++;
+            break;
+        }
+        case 4: // stray SOF whose header swallows the start of a good frame
+        {
+            bytes_t frame;
+            uint8_t fake[5];
+            uint32_t junk = rng() % 4;
+            do
+            {
+                frame   = make_frame(rng, len(rng));
+                fake[0] = SOF;
+                for (uint32_t i = 1; i <= junk; i++)
+                    fake[i] = not_sof(rng);
+                memcpy(fake + 1 + junk, frame.data(), 4 - junk);
+            } while (pyro::crc8(fake, 4) == fake[4]);
+            s.data.insert(s.data.end(), fake, fake + 1 + junk);
+            s.data.insert(s.data.end(), frame.begin(), frame.end());
+            s.frames.push_back(frame);
+            s.head_err_num++;
+            break;
+        }
+        default:
+        {
+            bytes_t frame = make_frame(rng, len(rng));
+            s.data.insert(s.data.end(), frame.begin(), frame.end());
+            s.frames.push_back(frame);
+            break;
+        }
+        }
+    }
+    return s;
+}
+
+// Takes every complete frame and checks it against the expected list
+template <typename Parser>
+void drain(Parser &parser, const stream_t &s, size_t &next, uint32_t &bad)
+{
+    for (const auto *frame = parser.front(); frame; frame = parser.front())
+    {
+        if (next >= s.frames.size() || frame->len != s.frames[next].size() ||
+            0 != memcmp(frame->data, s.frames[next].data(), frame->len) ||
+            Parser::payload_len(*frame) != frame->len - 9)
+            bad++;
+        next++;
+        parser.release();
+    }
+}
+
+void test_fuzz(std::mt19937 &rng)
+{
+    uint32_t bad = 0;
+    for (int round = 0; round < 300; round++)
+    {
+        stream_t s = make_stream(rng, 200);
+        std::unique_ptr<parser_t> parser(new parser_t);
+
+        // Byte at a time, whole stream at once, or random chunks
+        uint32_t mode  = round % 3;
+        size_t next    = 0;
+        size_t at      = 0;
+        uint32_t wrong = 0;
+        while (at < s.data.size())
+        {
+            size_t n = 0 == mode ? 1
+                     : 1 == mode ? s.data.size()
+                                 : 1 + rng() % 300;
+            if (n > s.data.size() - at)
+                n = s.data.size() - at;
+            parser->feed(&s.data[at], n);
+            at += n;
+            drain(*parser, s, next, wrong);
+        }
+
+        const parser_t::stats_t &st = parser->get_stats();
+        if (wrong || next != s.frames.size() ||
+            st.frame_num != s.frames.size() ||
+            st.head_err_num != s.head_err_num ||
+            st.crc_err_num != s.crc_err_num ||
+            st.oversize_num != s.oversize_num || st.drop_num ||
+            st.byte_num != s.data.size())
+        {
+            std::printf("round %d mode %u: frames %u/%zu head %u/%u crc %u/%u "
+                        "oversize %u/%u drop %u wrong %u\n",
+                        round, mode, st.frame_num, s.frames.size(),
+                        st.head_err_num, s.head_err_num, st.crc_err_num,
+                        s.crc_err_num, st.oversize_num, s.oversize_num,
+                        st.drop_num, wrong);
+            bad++;
+        }
+    }
+    CHECK(0 == bad);
+}
+
+// Two part spans, as handed over by the uart rx ring when it wraps
+void test_span(std::mt19937 &rng)
+{
+    typedef struct span_t
+    {
+        const uint8_t *data[2];
+        size_t len[2];
+    } span_t;
+
+    stream_t s = make_stream(rng, 100);
+    std::unique_ptr<parser_t> parser(new parser_t);
+    size_t next = 0, at = 0;
+    uint32_t wrong = 0;
+    while (at < s.data.size())
+    {
+        size_t n1 = rng() % 64, n2 = rng() % 64;
+        if (n1 > s.data.size() - at)
+            n1 = s.data.size() - at;
+        if (n2 > s.data.size() - at - n1)
+            n2 = s.data.size() - at - n1;
+        span_t span = {{&s.data[at], &s.data[at + n1]}, {n1, n2}};
+        parser->feed(span);
+        at += n1 + n2;
+        drain(*parser, s, next, wrong);
+    }
+    CHECK(0 == wrong && s.frames.size() == next);
+}
+
+// With every slot taken, good frames are counted as drops and parsing goes
+// on once the consumer catches up
+void test_no_slot(std::mt19937 &rng)
+{
+    pyro::frame_parser_t<MAX_FRAME, 4> parser;
+    std::vector<bytes_t> frames;
+    for (int i = 0; i < 7; i++)
+        frames.push_back(make_frame(rng, 10 + i));
+    for (int i = 0; i < 6; i++)
+        parser.feed(frames[i].data(), frames[i].size());
+
+    CHECK(4 == parser.get_stats().frame_num);
+    CHECK(2 == parser.get_stats().drop_num);
+    for (int i = 0; i < 4; i++)
+    {
+        const auto *frame = parser.front();
+        CHECK(frame && frame->len == frames[i].size() &&
+              0 == memcmp(frame->data, frames[i].data(), frame->len));
+        parser.release();
+    }
+    CHECK(nullptr == parser.front());
+
+    parser.feed(frames[6].data(), frames[6].size());
+    const auto *frame = parser.front();
+    CHECK(frame && frame->len == frames[6].size() &&
+          0 == memcmp(frame->data, frames[6].data(), frame->len));
+    CHECK(5 == parser.get_stats().frame_num);
+}
+
+// A partly received frame is dropped by reset
+void test_reset(std::mt19937 &rng)
+{
+    pyro::frame_parser_t<MAX_FRAME, 4> parser;
+    bytes_t a = make_frame(rng, 20), b = make_frame(rng, 20);
+    parser.feed(a.data(), 12);
+    parser.reset();
+    parser.feed(b.data(), b.size());
+    const auto *frame = parser.front();
+    CHECK(frame && 0 == memcmp(frame->data, b.data(), b.size()));
+    CHECK(1 == parser.get_stats().frame_num);
+}
+
+// Referee sized frames fed in DMA half buffer sized chunks
+void bench(std::mt19937 &rng)
+{
+    bytes_t data;
+    std::uniform_int_distribution<uint16_t> len(0, LEN_MAX);
+    while (data.size() < (8u << 20))
+    {
+        bytes_t frame = make_frame(rng, len(rng));
+        data.insert(data.end(), frame.begin(), frame.end());
+    }
+
+    std::unique_ptr<parser_t> parser(new parser_t);
+    constexpr size_t CHUNK = 64;
+    uint32_t frame_num     = 0;
+    double start           = host_test::now_ns();
+    for (size_t at = 0; at < data.size(); at += CHUNK)
+    {
+        size_t n = data.size() - at < CHUNK ? data.size() - at : CHUNK;
+        parser->feed(&data[at], n);
+        while (parser->front())
+        {
+            frame_num++;
+            parser->release();
+        }
+    }
+    double elapsed = host_test::now_ns() - start;
+    std::printf("parse: %.1f MB/s, %u frames\n",
+                data.size() / (elapsed / 1e9) / 1e6, frame_num);
+    CHECK(frame_num == parser->get_stats().frame_num);
+}
+} // namespace
+
+int main()
+{
+    std::mt19937 rng(0xA5A5);
+    test_fuzz(rng);
+    test_span(rng);
+    test_no_slot(rng);
+    test_reset(rng);
+    bench(rng);
+    return host_test::result();
+}
@@ -0,0 +1,216 @@
+#include "host_test.h"
+#include "mpmc_ring.h"
+#include "spsc_ring.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+// Ring stress tests and costs. Values carry the producer number in the high
+// half and a per producer count in the low half, so loss, duplication and
+// reordering all show up on the consumer side.
+namespace
+{
+constexpr uint32_t ITEM_NUM = 1000000;
+
+uint64_t make_value(uint32_t producer, uint32_t i)
+{
+    return static_cast<uint64_t>(producer) << 32 | i;
+}
+
+// One producer pushes half the items by value and half in place; the
+// consumer alternates pop with front / release the same way
+void test_spsc()
+{
+    static pyro::spsc_ring_t<uint64_t, 64> ring;
+    uint32_t bad_num = 0;
+
+    std::thread producer([] {
+        for (uint32_t i = 0; i < ITEM_NUM; i++)
+        {
+            for (;;)
+            {
+                if (i & 1)
+                {
+                    uint64_t *slot = ring.claim();
+                    if (slot)
+                    {
+                        *slot = make_value(0, i);
+                        ring.commit();
+                        break;
+                    }
+                }
+                else if (ring.push(make_value(0, i)))
+                    break;
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    double start = host_test::now_ns();
+    for (uint32_t i = 0; i < ITEM_NUM; i++)
+    {
+        uint64_t value;
+        for (;;)
+        {
+            if (i & 1)
+            {
+                uint64_t *slot = ring.front();
+                if (slot)
+                {
+                    value = *slot;
+                    ring.release();
+                    break;
+                }
+            }
+            else if (ring.pop(value))
+                break;
+            std::this_thread::yield();
+        }
+        if (value != make_value(0, i))
+            bad_num++;
+    }
+    double elapsed = host_test::now_ns() - start;
+    producer.join();
+
+    std::printf("spsc: %u items across threads, %.1f ns per item\n", ITEM_NUM,
+                elapsed / ITEM_NUM);
+    CHECK(0 == bad_num);
+    CHECK(ring.empty());
+}
+
+// Several producers and consumers: every value is taken exactly once, and
+// each consumer sees any one producer's values in increasing order
+void test_mpmc()
+{
+    constexpr uint32_t PRODUCER_NUM = 4;
+    constexpr uint32_t CONSUMER_NUM = 4;
+    constexpr uint32_t PER_PRODUCER = ITEM_NUM / PRODUCER_NUM;
+    static pyro::mpmc_ring_t<uint64_t, 64> ring;
+
+    std::vector<std::atomic<uint8_t>> seen(PRODUCER_NUM * PER_PRODUCER);
+    std::atomic<uint32_t> taken{0};
+    std::atomic<uint32_t> order_err{0};
+    std::atomic<uint32_t> range_err{0};
+    std::vector<std::thread> threads;
+
+    double start = host_test::now_ns();
+    for (uint32_t p = 0; p < PRODUCER_NUM; p++)
+    {
+        threads.emplace_back([p] {
+            for (uint32_t i = 0; i < PER_PRODUCER; i++)
+            {
+                while (!ring.push(make_value(p, i)))
+                    std::this_thread::yield();
+            }
+        });
+    }
+    for (uint32_t c = 0; c < CONSUMER_NUM; c++)
+    {
+        threads.emplace_back([&] {
+            int64_t last[PRODUCER_NUM];
+            for (int64_t &l : last)
+                l = -1;
+            while (taken.load(std::memory_order_relaxed) <
+                   PRODUCER_NUM * PER_PRODUCER)
+            {
+                uint64_t value;
+                if (!ring.pop(value))
+                {
+                    std::this_thread::yield();
+                    continue;
+                }
+                taken.fetch_add(1, std::memory_order_relaxed);
+                uint32_t p = value >> 32;
+                uint32_t i = static_cast<uint32_t>(value);
+                if (p >= PRODUCER_NUM || i >= PER_PRODUCER)
+                {
+                    range_err++;
+                    continue;
+                }
+                if (static_cast<int64_t>(i) <= last[p])
+                    order_err++;
+                last[p] = i;
+                seen[p * PER_PRODUCER + i]++;
+            }
+        });
+    }
+    for (std::thread &t : threads)
+        t.join();
+    double elapsed = host_test::now_ns() - start;
+
+    uint32_t missing = 0, twice = 0;
+    for (std::atomic<uint8_t> &s : seen)
+    {
+        if (0 == s)
+            missing++;
+        else if (s > 1)
+            twice++;
+    }
+    std::printf("mpmc: %u producers, %u consumers, %u items, %.1f ns per "
+                "item\n",
+                PRODUCER_NUM, CONSUMER_NUM, PRODUCER_NUM * PER_PRODUCER,
+                elapsed / (PRODUCER_NUM * PER_PRODUCER));
+    CHECK(0 == range_err);
+    CHECK(0 == order_err);
+    CHECK(0 == missing);
+    CHECK(0 == twice);
+    CHECK(ring.empty());
+}
+
+// Full and empty edges on one thread
+void test_edges()
+{
+    pyro::spsc_ring_t<uint32_t, 4> spsc;
+    pyro::mpmc_ring_t<uint32_t, 4> mpmc;
+    uint32_t value;
+
+    CHECK(!spsc.pop(value) && nullptr == spsc.front());
+    CHECK(!mpmc.pop(value));
+    for (uint32_t i = 0; i < 4; i++)
+    {
+        CHECK(spsc.push(i));
+        CHECK(mpmc.push(i));
+    }
+    CHECK(!spsc.push(4) && nullptr == spsc.claim());
+    CHECK(!mpmc.push(4));
+    CHECK(4 == spsc.size() && 4 == mpmc.size());
+    for (uint32_t i = 0; i < 4; i++)
+    {
+        CHECK(spsc.pop(value) && i == value);
+        CHECK(mpmc.pop(value) && i == value);
+    }
+    CHECK(spsc.empty() && mpmc.empty());
+}
+
+// Uncontended push + pop on one thread, the cost an ISR / task pair pays
+template <typename Ring> double bench_pair()
+{
+    constexpr uint32_t OP_NUM = 10000000;
+    static Ring ring;
+    uint64_t sum = 0, value = 0;
+
+    double start = host_test::now_ns();
+    for (uint32_t i = 0; i < OP_NUM; i++)
+    {
+        ring.push(i);
+        ring.pop(value);
+        sum += value;
+    }
+    double elapsed = host_test::now_ns() - start;
+    if (sum != static_cast<uint64_t>(OP_NUM) * (OP_NUM - 1) / 2)
+        host_test::fail_num()++;
+    return elapsed / OP_NUM;
+}
+} // namespace
+
+int main()
+{
+    test_edges();
+    test_spsc();
+    test_mpmc();
+    std::printf("push + pop: spsc %.2f ns, mpmc %.2f ns\n",
+                bench_pair<pyro::spsc_ring_t<uint64_t, 64>>(),
+                bench_pair<pyro::mpmc_ring_t<uint64_t, 64>>());
+    return host_test::result();
+}
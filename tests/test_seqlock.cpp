@@ -0,0 +1,141 @@
+#include "host_test.h"
+#include "pyro_seqlock.h"
+
+#include <atomic>
+#include <cstring>
+#include <thread>
+
+// Stress test: one writer thread republishes a CAN sized frame in place as
+// fast as it can while a reader takes snapshots. Every byte of a frame
+// carries the same counter, so a torn snapshot shows as a mismatch.
+namespace
+{
+typedef struct frame_t
+{
+    uint8_t data[64];
+    uint8_t len;
+    uint32_t timestamp;
+} frame_t;
+
+constexpr uint32_t WRITE_NUM = 2000000;
+
+bool consistent(const frame_t &frame)
+{
+    if (frame.len != frame.timestamp % 64)
+        return false;
+    for (uint8_t byte : frame.data)
+    {
+        if (byte != static_cast<uint8_t>(frame.timestamp))
+            return false;
+    }
+    return true;
+}
+
+void write_frame(pyro::seqlock_t<frame_t> &lock, uint32_t i)
+{
+    frame_t &frame = lock.write_begin();
+    memset(frame.data, static_cast<uint8_t>(i), sizeof(frame.data));
+    frame.len       = i % 64;
+    frame.timestamp = i;
+    lock.write_end();
+}
+
+void test_single_thread()
+{
+    pyro::seqlock_t<frame_t> lock;
+    frame_t frame;
+    CHECK(0 == lock.sequence());
+    CHECK(lock.read(frame));
+    write_frame(lock, 7);
+    CHECK(2 == lock.sequence());
+    CHECK(lock.read(frame));
+    CHECK(7 == frame.timestamp && consistent(frame));
+
+    uint32_t seen = 0;
+    CHECK(lock.read_with([&](const frame_t &f) { seen = f.timestamp; }));
+    CHECK(7 == seen);
+}
+
+void test_concurrent()
+{
+    static pyro::seqlock_t<frame_t> lock;
+    std::atomic<bool> done{false};
+    uint64_t ok_num   = 0;
+    uint64_t fail_num = 0;
+    uint64_t torn_num = 0;
+    uint32_t last     = 0;
+    bool backwards    = false;
+
+    write_frame(lock, 0);
+    std::thread writer([&] {
+        for (uint32_t i = 1; i <= WRITE_NUM; i++)
+            write_frame(lock, i);
+        done.store(true, std::memory_order_release);
+    });
+
+    double start = host_test::now_ns();
+    while (!done.load(std::memory_order_acquire))
+    {
+        frame_t frame;
+        if (!lock.read(frame))
+        {
+            fail_num++;
+            continue;
+        }
+        ok_num++;
+        if (!consistent(frame))
+            torn_num++;
+        if (frame.timestamp < last)
+            backwards = true;
+        last = frame.timestamp;
+
+        // The in place reader must see the same guarantee
+        bool same = true;
+        if (lock.read_with([&](const frame_t &f) { same = consistent(f); }) &&
+            !same)
+            torn_num++;
+    }
+    double elapsed = host_test::now_ns() - start;
+    writer.join();
+
+    std::printf("concurrent: %u writes, %llu reads ok, %llu retries "
+                "exhausted, %llu torn, %.1f ns per read pair\n",
+                WRITE_NUM, static_cast<unsigned long long>(ok_num),
+                static_cast<unsigned long long>(fail_num),
+                static_cast<unsigned long long>(torn_num),
+                ok_num ? elapsed / (ok_num + fail_num) : 0.0);
+    CHECK(0 == torn_num);
+    CHECK(!backwards);
+    CHECK(ok_num > 0);
+
+    frame_t frame;
+    CHECK(lock.read(frame) && WRITE_NUM == frame.timestamp);
+}
+
+void bench_read()
+{
+    static pyro::seqlock_t<frame_t> lock;
+    write_frame(lock, 1);
+    constexpr uint32_t READ_NUM = 10000000;
+    frame_t frame{};
+    uint32_t sum = 0;
+
+    double start = host_test::now_ns();
+    for (uint32_t i = 0; i < READ_NUM; i++)
+    {
+        lock.read(frame);
+        sum += frame.len;
+    }
+    double elapsed = host_test::now_ns() - start;
+    std::printf("uncontended read of %zu bytes: %.2f ns (%u)\n",
+                sizeof(frame_t), elapsed / READ_NUM, sum);
+}
+} // namespace
+
+int main()
+{
+    test_single_thread();
+    test_concurrent();
+    bench_read();
+    return host_test::result();
+}
@@ -0,0 +1,167 @@
+#include "pyro_can_planner.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// Host front end of can_planner_t: reads a flow list, prints the budget of
+// every bus and exits non-zero if one is overloaded, so a planned layout can
+// be checked before it is flashed. Input, one item per line, # comments:
+//   bus  <bus> <nom_bit_ns> <data_bit_ns>
+//   flow <bus> <id> <len> <rate_hz> <rx|tx> [ext] [fd] [brs]
+// <bus> is the can_hub_t::which_can index, can1 = 0. Numbers may be hex.
+namespace
+{
+typedef pyro::can_planner_t planner_t;
+
+bool parse_flow(planner_t *planner, char *save, int line_no)
+{
+    const char *arg[5];
+    for (const char *&a : arg)
+    {
+        a = strtok_r(nullptr, " \t", &save);
+        if (nullptr == a)
+        {
+            std::fprintf(stderr, "line %d: flow needs 5 fields\n", line_no);
+            return false;
+        }
+    }
+    bool ext = false, fd = false, brs = false;
+    for (const char *opt = strtok_r(nullptr, " \t", &save); opt;
+         opt             = strtok_r(nullptr, " \t", &save))
+    {
+        if (0 == strcmp(opt, "ext"))
+            ext = true;
+        else if (0 == strcmp(opt, "fd"))
+            fd = true;
+        else if (0 == strcmp(opt, "brs"))
+            fd = brs = true;
+        else
+        {
+            std::fprintf(stderr, "line %d: unknown option %s\n", line_no, opt);
+            return false;
+        }
+    }
+
+    planner_t::dir_t dir;
+    if (0 == strcmp(arg[4], "rx"))
+        dir = planner_t::dir_rx;
+    else if (0 == strcmp(arg[4], "tx"))
+        dir = planner_t::dir_tx;
+    else
+    {
+        std::fprintf(stderr, "line %d: direction is rx or tx\n", line_no);
+        return false;
+    }
+
+    unsigned long len = strtoul(arg[2], nullptr, 0);
+    if (len > (fd ? 64UL : 8UL))
+    {
+        std::fprintf(stderr, "line %d: %lu bytes do not fit a frame\n",
+                     line_no, len);
+        return false;
+    }
+    pyro::status_t ret = planner->add_flow(
+        strtoul(arg[0], nullptr, 0), strtoul(arg[1], nullptr, 0),
+        static_cast<uint8_t>(len), strtoul(arg[3], nullptr, 0), dir, ext, fd,
+        brs);
+    if (pyro::PYRO_OK != ret)
+    {
+        std::fprintf(stderr, "line %d: flow rejected (%d)\n", line_no, ret);
+        return false;
+    }
+    return true;
+}
+
+bool parse(FILE *in, planner_t *planner)
+{
+    char line[256];
+    for (int line_no = 1; fgets(line, sizeof(line), in); line_no++)
+    {
+        char *hash = strchr(line, '#');
+        if (hash)
+            *hash = '\0';
+        line[strcspn(line, "\r\n")] = '\0';
+
+        char *save      = nullptr;
+        const char *key = strtok_r(line, " \t", &save);
+        if (nullptr == key)
+            continue;
+        if (0 == strcmp(key, "bus"))
+        {
+            const char *bus  = strtok_r(nullptr, " \t", &save);
+            const char *nom  = strtok_r(nullptr, " \t", &save);
+            const char *data = strtok_r(nullptr, " \t", &save);
+            if (nullptr == data || strtoul(bus, nullptr, 0) >= CAN_BUS_NUM)
+            {
+                std::fprintf(stderr, "line %d: bad bus line\n", line_no);
+                return false;
+            }
+            planner->set_bit_time(strtoul(bus, nullptr, 0),
+                                  strtoul(nom, nullptr, 0),
+                                  strtoul(data, nullptr, 0));
+        }
+        else if (0 == strcmp(key, "flow"))
+        {
+            if (!parse_flow(planner, save, line_no))
+                return false;
+        }
+        else
+        {
+            std::fprintf(stderr, "line %d: unknown item %s\n", line_no, key);
+            return false;
+        }
+    }
+    return true;
+}
+
+void print_bus(planner_t *planner, uint8_t bus)
+{
+    const planner_t::bus_plan_t &plan = planner->get_plan(bus);
+    uint8_t flow_num;
+    const planner_t::flow_t *flows = planner->get_flows(bus, flow_num);
+    if (0 == flow_num)
+        return;
+
+    std::printf("can%u: %u flows, load %u.%u%%, worst response %u us "
+                "(id 0x%X), %u missed%s\n",
+                bus + 1, flow_num, plan.load_permille / 10,
+                plan.load_permille % 10, plan.worst_response_us,
+                plan.worst_id, plan.miss_num,
+                plan.overload ? ", OVERLOAD" : "");
+    for (uint8_t i = 0; i < flow_num; i++)
+    {
+        const planner_t::flow_t &f = flows[i];
+        uint32_t period_us         = 1000000 / f.rate_hz;
+        std::printf("  %s 0x%08X %2u B %5u Hz%s%s  frame %6.1f us  "
+                    "response %5u us / %u%s\n",
+                    planner_t::dir_tx == f.dir ? "tx" : "rx", f.id, f.len,
+                    f.rate_hz, f.extended ? " ext" : "",
+                    f.brs ? " brs" : (f.fd ? " fd" : ""), f.frame_ns / 1000.0,
+                    f.response_us, period_us,
+                    f.response_us > period_us ? "  MISS" : "");
+    }
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+    FILE *in = stdin;
+    if (argc > 1 && nullptr == (in = fopen(argv[1], "r")))
+    {
+        std::perror(argv[1]);
+        return 2;
+    }
+
+    planner_t *planner = planner_t::get_instance();
+    bool ok            = parse(in, planner);
+    if (stdin != in)
+        fclose(in);
+    if (!ok)
+        return 2;
+
+    pyro::status_t ret = planner->analyse();
+    for (uint8_t bus = 0; bus < CAN_BUS_NUM; bus++)
+        print_bus(planner, bus);
+    return pyro::PYRO_OK == ret ? 0 : 1;
+}